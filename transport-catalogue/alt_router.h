@@ -0,0 +1,285 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// A* search guided by landmarks (ALT). For every landmark L the router keeps d(L, v) and
+// d(v, L) for all vertices; by the triangle inequality d(L, t) - d(L, v) and
+// d(v, L) - d(t, L) are lower bounds of d(v, t), and the largest of them steers the
+// search towards the target. Distances are kept as WeightTraits<Weight>::Scalar.
+template <typename Weight>
+class AltRouter final : public BaseRouter<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using Traits = WeightTraits<Weight>;
+    using Scalar = typename Traits::Scalar;
+
+    static_assert(std::numeric_limits<Scalar>::has_infinity,
+                  "Unreachable landmarks are kept as an infinite distance");
+
+public:
+    using RouteInfo = typename BaseRouter<Weight>::RouteInfo;
+    using SearchStats = typename BaseRouter<Weight>::SearchStats;
+
+    AltRouter(const Graph& graph, std::vector<VertexId> landmarks,
+              size_t thread_count = parallel::DefaultThreadCount());
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    SearchStats GetSearchStats() const override {
+        return {queries_.load(), settled_vertices_.load()};
+    }
+
+    const std::vector<VertexId>& GetLandmarks() const {
+        return landmarks_;
+    }
+
+private:
+    static constexpr Scalar INFINITE_DISTANCE = std::numeric_limits<Scalar>::infinity();
+
+    struct HeapItem {
+        Scalar key;
+        Weight weight;
+        VertexId vertex;
+
+        bool operator<(const HeapItem& other) const {
+            return other.key < key;
+        }
+    };
+
+    struct SearchState {
+        std::vector<Weight> weights;
+        std::vector<std::optional<EdgeId>> prev_edges;
+        std::vector<uint64_t> stamps;
+        std::vector<HeapItem> heap;
+        uint64_t generation = 0;
+
+        void Reset(size_t vertex_count) {
+            if (stamps.size() < vertex_count) {
+                weights.resize(vertex_count);
+                prev_edges.resize(vertex_count);
+                stamps.resize(vertex_count, 0);
+            }
+            heap.clear();
+            ++generation;
+        }
+
+        bool IsReached(VertexId vertex) const {
+            return stamps[vertex] == generation;
+        }
+    };
+
+    static SearchState& GetSearchState() {
+        static thread_local SearchState state;
+        return state;
+    }
+
+    // Distances of one landmark to (is_reverse) or from every vertex, written with a
+    // stride of the landmark count.
+    void ComputeLandmarkDistances(size_t landmark, bool is_reverse);
+    Scalar EstimateDistance(VertexId vertex, VertexId to) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    std::vector<VertexId> landmarks_;
+    // Incoming edges by target vertex, for searches towards a landmark.
+    std::vector<size_t> in_offsets_;
+    std::vector<std::pair<VertexId, Scalar>> in_edges_;
+    // Row-major vertex x landmark tables.
+    std::vector<Scalar> from_landmarks_;
+    std::vector<Scalar> to_landmarks_;
+
+    mutable std::atomic<size_t> queries_{0};
+    mutable std::atomic<size_t> settled_vertices_{0};
+};
+
+template <typename Weight>
+AltRouter<Weight>::AltRouter(const Graph& graph, std::vector<VertexId> landmarks, size_t thread_count)
+    : graph_(graph)
+    , landmarks_(std::move(landmarks))
+    , in_offsets_(graph.GetVertexCount() + 1, 0)
+    , from_landmarks_(graph.GetVertexCount() * landmarks_.size(), INFINITE_DISTANCE)
+    , to_landmarks_(graph.GetVertexCount() * landmarks_.size(), INFINITE_DISTANCE)
+{
+    const size_t vertex_count = graph.GetVertexCount();
+    for (const VertexId landmark : landmarks_) {
+        if (landmark >= vertex_count) {
+            throw std::out_of_range("Landmark is out of range");
+        }
+    }
+
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        ++in_offsets_[edge.to + 1];
+    }
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        in_offsets_[vertex + 1] += in_offsets_[vertex];
+    }
+    in_edges_.resize(graph.GetEdgeCount());
+    std::vector<size_t> fill(in_offsets_.begin(), in_offsets_.end() - 1);
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        in_edges_[fill[edge.to]++] = {edge.from, Traits::ToScalar(edge.weight)};
+    }
+
+    parallel::ThreadPool pool(thread_count);
+    pool.ParallelFor(landmarks_.size() * 2, [this](size_t task) {
+        ComputeLandmarkDistances(task / 2, task % 2 == 1);
+    });
+}
+
+template <typename Weight>
+void AltRouter<Weight>::ComputeLandmarkDistances(size_t landmark, bool is_reverse) {
+    const size_t stride = landmarks_.size();
+    std::vector<Scalar>& table = is_reverse ? to_landmarks_ : from_landmarks_;
+    const auto distance = [&table, stride, landmark](VertexId vertex) -> Scalar& {
+        return table[vertex * stride + landmark];
+    };
+
+    using Item = std::pair<Scalar, VertexId>;
+    std::vector<Item> heap{{Scalar{}, landmarks_[landmark]}};
+    distance(landmarks_[landmark]) = Scalar{};
+    const auto relax = [&heap, &distance](VertexId vertex, Scalar candidate) {
+        if (candidate < distance(vertex)) {
+            distance(vertex) = candidate;
+            heap.push_back({candidate, vertex});
+            std::push_heap(heap.begin(), heap.end(), std::greater<Item>{});
+        }
+    };
+
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<Item>{});
+        const auto [key, vertex] = heap.back();
+        heap.pop_back();
+        if (distance(vertex) < key) {
+            continue;
+        }
+        if (is_reverse) {
+            for (size_t i = in_offsets_[vertex]; i < in_offsets_[vertex + 1]; ++i) {
+                relax(in_edges_[i].first, key + in_edges_[i].second);
+            }
+        } else {
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+                const auto& edge = graph_.GetEdge(edge_id);
+                relax(edge.to, key + Traits::ToScalar(edge.weight));
+            }
+        }
+    }
+}
+
+template <typename Weight>
+typename AltRouter<Weight>::Scalar AltRouter<Weight>::EstimateDistance(VertexId vertex, VertexId to) const {
+    // With no landmarks the tables are empty and the estimate stays 0.
+    const size_t stride = landmarks_.size();
+    const Scalar* from_vertex = from_landmarks_.data() + vertex * stride;
+    const Scalar* from_target = from_landmarks_.data() + to * stride;
+    const Scalar* to_vertex = to_landmarks_.data() + vertex * stride;
+    const Scalar* to_target = to_landmarks_.data() + to * stride;
+
+    Scalar estimate{};
+    for (size_t i = 0; i < stride; ++i) {
+        // A landmark that reaches the vertex but not the target, or one reached from the
+        // target but not from the vertex, proves the target unreachable from the vertex.
+        if (from_vertex[i] != INFINITE_DISTANCE) {
+            if (from_target[i] == INFINITE_DISTANCE) {
+                return INFINITE_DISTANCE;
+            }
+            estimate = std::max(estimate, from_target[i] - from_vertex[i]);
+        }
+        if (to_target[i] != INFINITE_DISTANCE) {
+            if (to_vertex[i] == INFINITE_DISTANCE) {
+                return INFINITE_DISTANCE;
+            }
+            estimate = std::max(estimate, to_vertex[i] - to_target[i]);
+        }
+    }
+    return estimate;
+}
+
+template <typename Weight>
+std::optional<typename AltRouter<Weight>::RouteInfo> AltRouter<Weight>::BuildRoute(VertexId from,
+                                                                                   VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    SearchState& state = GetSearchState();
+    state.Reset(vertex_count);
+    size_t settled = 0;
+
+    const Scalar start_estimate = EstimateDistance(from, to);
+    if (start_estimate != INFINITE_DISTANCE) {
+        state.stamps[from] = state.generation;
+        state.weights[from] = ZERO_WEIGHT;
+        state.prev_edges[from] = std::nullopt;
+        state.heap.push_back({start_estimate, ZERO_WEIGHT, from});
+    }
+
+    bool is_found = false;
+    while (!state.heap.empty()) {
+        std::pop_heap(state.heap.begin(), state.heap.end());
+        const HeapItem item = state.heap.back();
+        state.heap.pop_back();
+
+        if (state.weights[item.vertex] < item.weight) {
+            continue;
+        }
+        ++settled;
+        if (item.vertex == to) {
+            is_found = true;
+            break;
+        }
+
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(item.vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Weight candidate_weight = item.weight + edge.weight;
+            if (state.IsReached(edge.to) && !(candidate_weight < state.weights[edge.to])) {
+                continue;
+            }
+            const Scalar estimate = EstimateDistance(edge.to, to);
+            if (estimate == INFINITE_DISTANCE) {
+                continue;
+            }
+            state.stamps[edge.to] = state.generation;
+            state.weights[edge.to] = candidate_weight;
+            state.prev_edges[edge.to] = edge_id;
+            state.heap.push_back({Traits::ToScalar(candidate_weight) + estimate, candidate_weight, edge.to});
+            std::push_heap(state.heap.begin(), state.heap.end());
+        }
+    }
+
+    ++queries_;
+    settled_vertices_ += settled;
+    if (!is_found) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (std::optional<EdgeId> edge_id = state.prev_edges[to];
+         edge_id;
+         edge_id = state.prev_edges[graph_.GetEdge(*edge_id).from])
+    {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{state.weights[to], std::move(edges)};
+}
+
+}
@@ -0,0 +1,486 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Contraction hierarchy over a DirectedWeightedGraph. Vertices are contracted one by one
+// in edge-difference order; every contraction adds shortcut edges that keep the ids of
+// the two hierarchy edges they replace, so a route unpacks back to original EdgeIds.
+// Queries run a bidirectional search that only goes up the hierarchy.
+template <typename Weight>
+class ContractionHierarchy final : public BaseRouter<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename BaseRouter<Weight>::RouteInfo;
+
+    explicit ContractionHierarchy(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    size_t GetShortcutCount() const {
+        return shortcut_count_;
+    }
+
+private:
+    static constexpr size_t NO_EDGE = std::numeric_limits<size_t>::max();
+    // A witness search gives up after settling this many vertices and the shortcut is
+    // added anyway: an extra shortcut costs some memory, never correctness.
+    static constexpr size_t WITNESS_SETTLE_LIMIT = 128;
+
+    struct HierarchyEdge {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        EdgeId original = NO_EDGE;
+        size_t first_child = NO_EDGE;
+        size_t second_child = NO_EDGE;
+    };
+
+    struct Arc {
+        VertexId to;
+        Weight weight;
+        size_t edge;
+    };
+
+    struct UpwardGraph {
+        std::vector<size_t> offsets;
+        std::vector<Arc> arcs;
+
+        ranges::Range<typename std::vector<Arc>::const_iterator> GetArcs(VertexId vertex) const {
+            return {arcs.begin() + offsets[vertex], arcs.begin() + offsets[vertex + 1]};
+        }
+    };
+
+    template <typename Key>
+    struct HeapItem {
+        Key key;
+        VertexId vertex;
+
+        bool operator<(const HeapItem& other) const {
+            return other.key < key;
+        }
+    };
+
+    struct SearchSide {
+        std::vector<Weight> weights;
+        std::vector<size_t> parent_edges;
+        std::vector<uint64_t> stamps;
+        std::vector<HeapItem<Weight>> heap;
+
+        void Reset(size_t vertex_count) {
+            if (stamps.size() < vertex_count) {
+                weights.resize(vertex_count);
+                parent_edges.resize(vertex_count);
+                stamps.resize(vertex_count, 0);
+            }
+            heap.clear();
+        }
+    };
+
+    struct SearchState {
+        SearchSide forward;
+        SearchSide backward;
+        uint64_t generation = 0;
+    };
+
+    static SearchState& GetSearchState() {
+        static thread_local SearchState state;
+        return state;
+    }
+
+    struct Contraction {
+        std::vector<HierarchyEdge> shortcuts;
+        int in_degree = 0;
+        int out_degree = 0;
+    };
+
+    void LoadEdges(const Graph& graph);
+    Contraction ContractVertex(VertexId vertex);
+    void RunWitnessSearch(VertexId source, VertexId excluded, const Weight& limit);
+    void CommitContraction(VertexId vertex, Contraction&& contraction, size_t rank);
+    void BuildUpwardGraphs();
+
+    void Settle(SearchSide& side, const SearchSide& other, const UpwardGraph& upward,
+                const UpwardGraph& downward, uint64_t generation,
+                std::optional<Weight>& best, VertexId& meeting) const;
+    void AppendUnpacked(size_t edge, std::vector<EdgeId>& edges) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+
+    size_t vertex_count_;
+    size_t shortcut_count_ = 0;
+    std::vector<HierarchyEdge> edges_;
+    std::vector<size_t> ranks_;
+    UpwardGraph forward_up_;
+    UpwardGraph backward_up_;
+
+    // Construction-only state, released when the hierarchy is built.
+    std::vector<std::vector<size_t>> out_edges_;
+    std::vector<std::vector<size_t>> in_edges_;
+    std::vector<bool> contracted_;
+    std::vector<int> contracted_neighbours_;
+    SearchSide witness_;
+    uint64_t witness_generation_ = 0;
+};
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph)
+    : vertex_count_(graph.GetVertexCount())
+    , ranks_(graph.GetVertexCount())
+    , out_edges_(graph.GetVertexCount())
+    , in_edges_(graph.GetVertexCount())
+    , contracted_(graph.GetVertexCount(), false)
+    , contracted_neighbours_(graph.GetVertexCount(), 0)
+{
+    LoadEdges(graph);
+    witness_.Reset(vertex_count_);
+
+    using Priority = std::pair<int, VertexId>;
+    std::vector<HeapItem<Priority>> queue;
+    queue.reserve(vertex_count_);
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        const Contraction contraction = ContractVertex(vertex);
+        const int priority = static_cast<int>(contraction.shortcuts.size())
+            - contraction.in_degree - contraction.out_degree;
+        queue.push_back({{priority, vertex}, vertex});
+    }
+    std::make_heap(queue.begin(), queue.end());
+
+    size_t rank = 0;
+    while (!queue.empty()) {
+        std::pop_heap(queue.begin(), queue.end());
+        const VertexId vertex = queue.back().vertex;
+        queue.pop_back();
+
+        Contraction contraction = ContractVertex(vertex);
+        const int priority = static_cast<int>(contraction.shortcuts.size())
+            - contraction.in_degree - contraction.out_degree + contracted_neighbours_[vertex];
+        if (!queue.empty() && queue.front().key < Priority{priority, vertex}) {
+            queue.push_back({{priority, vertex}, vertex});
+            std::push_heap(queue.begin(), queue.end());
+            continue;
+        }
+        CommitContraction(vertex, std::move(contraction), rank++);
+    }
+
+    BuildUpwardGraphs();
+
+    out_edges_ = {};
+    in_edges_ = {};
+    contracted_ = {};
+    contracted_neighbours_ = {};
+    witness_ = {};
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::LoadEdges(const Graph& graph) {
+    std::vector<EdgeId> order;
+    order.reserve(graph.GetEdgeCount());
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        if (edge.from != edge.to) {
+            order.push_back(edge_id);
+        }
+    }
+
+    // Only the lightest of parallel edges can lie on a shortest path.
+    std::sort(order.begin(), order.end(), [&graph](EdgeId lhs, EdgeId rhs) {
+        const auto& l = graph.GetEdge(lhs);
+        const auto& r = graph.GetEdge(rhs);
+        if (l.from != r.from || l.to != r.to) {
+            return std::pair{l.from, l.to} < std::pair{r.from, r.to};
+        }
+        if (l.weight < r.weight || r.weight < l.weight) {
+            return l.weight < r.weight;
+        }
+        return lhs < rhs;
+    });
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        const auto& edge = graph.GetEdge(order[i]);
+        if (i > 0) {
+            const auto& prev = graph.GetEdge(order[i - 1]);
+            if (prev.from == edge.from && prev.to == edge.to) {
+                continue;
+            }
+        }
+        out_edges_[edge.from].push_back(edges_.size());
+        in_edges_[edge.to].push_back(edges_.size());
+        edges_.push_back({edge.from, edge.to, edge.weight, order[i]});
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::RunWitnessSearch(VertexId source, VertexId excluded,
+                                                     const Weight& limit) {
+    SearchSide& side = witness_;
+    side.heap.clear();
+    const uint64_t generation = ++witness_generation_;
+
+    side.stamps[source] = generation;
+    side.weights[source] = ZERO_WEIGHT;
+    side.heap.push_back({ZERO_WEIGHT, source});
+
+    size_t settled = 0;
+    while (!side.heap.empty() && settled < WITNESS_SETTLE_LIMIT) {
+        std::pop_heap(side.heap.begin(), side.heap.end());
+        const auto item = side.heap.back();
+        side.heap.pop_back();
+        if (side.weights[item.vertex] < item.key) {
+            continue;
+        }
+        if (limit < item.key) {
+            break;
+        }
+        ++settled;
+
+        for (const size_t edge_index : out_edges_[item.vertex]) {
+            const HierarchyEdge& edge = edges_[edge_index];
+            if (edge.to == excluded || contracted_[edge.to]) {
+                continue;
+            }
+            const Weight candidate = item.key + edge.weight;
+            if (side.stamps[edge.to] != generation || candidate < side.weights[edge.to]) {
+                side.stamps[edge.to] = generation;
+                side.weights[edge.to] = candidate;
+                side.heap.push_back({candidate, edge.to});
+                std::push_heap(side.heap.begin(), side.heap.end());
+            }
+        }
+    }
+}
+
+template <typename Weight>
+typename ContractionHierarchy<Weight>::Contraction
+ContractionHierarchy<Weight>::ContractVertex(VertexId vertex) {
+    Contraction contraction;
+
+    std::optional<Weight> max_out;
+    for (const size_t out_index : out_edges_[vertex]) {
+        const HierarchyEdge& out = edges_[out_index];
+        if (contracted_[out.to]) {
+            continue;
+        }
+        ++contraction.out_degree;
+        if (!max_out || *max_out < out.weight) {
+            max_out = out.weight;
+        }
+    }
+
+    for (const size_t in_index : in_edges_[vertex]) {
+        const HierarchyEdge& in = edges_[in_index];
+        if (contracted_[in.from]) {
+            continue;
+        }
+        ++contraction.in_degree;
+        if (!max_out) {
+            continue;
+        }
+
+        RunWitnessSearch(in.from, vertex, in.weight + *max_out);
+        for (const size_t out_index : out_edges_[vertex]) {
+            const HierarchyEdge& out = edges_[out_index];
+            if (contracted_[out.to] || out.to == in.from) {
+                continue;
+            }
+            const Weight via = in.weight + out.weight;
+            if (witness_.stamps[out.to] == witness_generation_ && !(via < witness_.weights[out.to])) {
+                continue;
+            }
+            contraction.shortcuts.push_back({in.from, out.to, via, NO_EDGE, in_index, out_index});
+        }
+    }
+
+    return contraction;
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::CommitContraction(VertexId vertex, Contraction&& contraction,
+                                                     size_t rank) {
+    for (HierarchyEdge& shortcut : contraction.shortcuts) {
+        out_edges_[shortcut.from].push_back(edges_.size());
+        in_edges_[shortcut.to].push_back(edges_.size());
+        edges_.push_back(std::move(shortcut));
+    }
+    shortcut_count_ += contraction.shortcuts.size();
+
+    contracted_[vertex] = true;
+    ranks_[vertex] = rank;
+
+    const auto drop_contracted = [this](std::vector<size_t>& list, bool by_target) {
+        list.erase(std::remove_if(list.begin(), list.end(), [this, by_target](size_t index) {
+            return contracted_[by_target ? edges_[index].to : edges_[index].from];
+        }), list.end());
+    };
+    for (const size_t out_index : out_edges_[vertex]) {
+        const VertexId neighbour = edges_[out_index].to;
+        if (!contracted_[neighbour]) {
+            ++contracted_neighbours_[neighbour];
+            drop_contracted(in_edges_[neighbour], false);
+        }
+    }
+    for (const size_t in_index : in_edges_[vertex]) {
+        const VertexId neighbour = edges_[in_index].from;
+        if (!contracted_[neighbour]) {
+            ++contracted_neighbours_[neighbour];
+            drop_contracted(out_edges_[neighbour], true);
+        }
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::BuildUpwardGraphs() {
+    forward_up_.offsets.assign(vertex_count_ + 1, 0);
+    backward_up_.offsets.assign(vertex_count_ + 1, 0);
+    for (const HierarchyEdge& edge : edges_) {
+        if (ranks_[edge.from] < ranks_[edge.to]) {
+            ++forward_up_.offsets[edge.from + 1];
+        } else {
+            ++backward_up_.offsets[edge.to + 1];
+        }
+    }
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        forward_up_.offsets[vertex + 1] += forward_up_.offsets[vertex];
+        backward_up_.offsets[vertex + 1] += backward_up_.offsets[vertex];
+    }
+
+    forward_up_.arcs.resize(forward_up_.offsets.back());
+    backward_up_.arcs.resize(backward_up_.offsets.back());
+    std::vector<size_t> forward_fill(forward_up_.offsets.begin(), forward_up_.offsets.end() - 1);
+    std::vector<size_t> backward_fill(backward_up_.offsets.begin(), backward_up_.offsets.end() - 1);
+    for (size_t index = 0; index < edges_.size(); ++index) {
+        const HierarchyEdge& edge = edges_[index];
+        if (ranks_[edge.from] < ranks_[edge.to]) {
+            forward_up_.arcs[forward_fill[edge.from]++] = {edge.to, edge.weight, index};
+        } else {
+            backward_up_.arcs[backward_fill[edge.to]++] = {edge.from, edge.weight, index};
+        }
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::Settle(SearchSide& side, const SearchSide& other,
+                                          const UpwardGraph& upward, const UpwardGraph& downward,
+                                          uint64_t generation,
+                                          std::optional<Weight>& best, VertexId& meeting) const {
+    std::pop_heap(side.heap.begin(), side.heap.end());
+    const auto item = side.heap.back();
+    side.heap.pop_back();
+    if (side.weights[item.vertex] < item.key) {
+        return;
+    }
+
+    if (other.stamps[item.vertex] == generation) {
+        const Weight candidate = item.key + other.weights[item.vertex];
+        if (!best || candidate < *best) {
+            best = candidate;
+            meeting = item.vertex;
+        }
+    }
+
+    // Stall on demand: a higher vertex already offers a shorter way here, so nothing
+    // relaxed from this vertex can be part of a shortest path.
+    for (const Arc& arc : downward.GetArcs(item.vertex)) {
+        if (side.stamps[arc.to] == generation && side.weights[arc.to] + arc.weight < item.key) {
+            return;
+        }
+    }
+
+    for (const Arc& arc : upward.GetArcs(item.vertex)) {
+        const Weight candidate = item.key + arc.weight;
+        if (side.stamps[arc.to] != generation || candidate < side.weights[arc.to]) {
+            side.stamps[arc.to] = generation;
+            side.weights[arc.to] = candidate;
+            side.parent_edges[arc.to] = arc.edge;
+            side.heap.push_back({candidate, arc.to});
+            std::push_heap(side.heap.begin(), side.heap.end());
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchy<Weight>::RouteInfo>
+ContractionHierarchy<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    SearchState& state = GetSearchState();
+    state.forward.Reset(vertex_count_);
+    state.backward.Reset(vertex_count_);
+    const uint64_t generation = ++state.generation;
+
+    for (auto [side, start] : {std::pair{&state.forward, from}, std::pair{&state.backward, to}}) {
+        side -> stamps[start] = generation;
+        side -> weights[start] = ZERO_WEIGHT;
+        side -> parent_edges[start] = NO_EDGE;
+        side -> heap.push_back({ZERO_WEIGHT, start});
+    }
+
+    std::optional<Weight> best;
+    VertexId meeting = from;
+    const auto is_done = [&best](const SearchSide& side) {
+        return side.heap.empty() || (best && !(side.heap.front().key < *best));
+    };
+    while (!is_done(state.forward) || !is_done(state.backward)) {
+        if (is_done(state.backward)
+            || (!is_done(state.forward) && !(state.backward.heap.front().key < state.forward.heap.front().key))) {
+            Settle(state.forward, state.backward, forward_up_, backward_up_, generation, best, meeting);
+        } else {
+            Settle(state.backward, state.forward, backward_up_, forward_up_, generation, best, meeting);
+        }
+    }
+
+    if (!best) {
+        return std::nullopt;
+    }
+
+    std::vector<size_t> up_path;
+    for (VertexId vertex = meeting; state.forward.parent_edges[vertex] != NO_EDGE;
+         vertex = edges_[state.forward.parent_edges[vertex]].from) {
+        up_path.push_back(state.forward.parent_edges[vertex]);
+    }
+
+    std::vector<EdgeId> edges;
+    for (auto it = up_path.rbegin(); it != up_path.rend(); ++it) {
+        AppendUnpacked(*it, edges);
+    }
+    for (VertexId vertex = meeting; state.backward.parent_edges[vertex] != NO_EDGE;
+         vertex = edges_[state.backward.parent_edges[vertex]].to) {
+        AppendUnpacked(state.backward.parent_edges[vertex], edges);
+    }
+
+    return RouteInfo{*best, std::move(edges)};
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::AppendUnpacked(size_t edge, std::vector<EdgeId>& edges) const {
+    std::vector<size_t> stack{edge};
+    while (!stack.empty()) {
+        const HierarchyEdge& current = edges_[stack.back()];
+        stack.pop_back();
+        if (current.original != NO_EDGE) {
+            edges.push_back(current.original);
+        } else {
+            stack.push_back(current.second_child);
+            stack.push_back(current.first_child);
+        }
+    }
+}
+
+}
@@ -0,0 +1,66 @@
+#include "distance_table.h"
+
+
+namespace transport_directory {
+
+    namespace {
+        // The splitmix64 finalizer: every key bit reaches every bit of the hash, so the
+        // low bits that pick a slot depend on both stop ids.
+        uint64_t Mix(uint64_t key){
+            key ^= key >> 30;
+            key *= 0xbf58476d1ce4e5b9ULL;
+            key ^= key >> 27;
+            key *= 0x94d049bb133111ebULL;
+            key ^= key >> 31;
+            return key;
+        }
+    }
+
+    uint64_t DistanceTable::Pack(domain::StopId from, domain::StopId to){
+        return (static_cast<uint64_t>(from) << 32) | to;
+    }
+
+    size_t DistanceTable::Probe(uint64_t key) const {
+        const size_t mask = slots_.size() - 1;
+        size_t index = Mix(key) & mask;
+        while (slots_[index].key != key && slots_[index].key != EMPTY){
+            index = (index + 1) & mask;
+        }
+        return index;
+    }
+
+    void DistanceTable::Grow(){
+        std::vector<Slot> old = std::move(slots_);
+        slots_.assign(old.empty() ? MIN_CAPACITY : old.size() * 2, Slot{});
+        for (const Slot& slot : old){
+            if (slot.key != EMPTY){
+                slots_[Probe(slot.key)] = slot;
+            }
+        }
+    }
+
+    void DistanceTable::Insert(domain::StopId from, domain::StopId to, int distance){
+        if (2 * (size_ + 1) > slots_.size()){
+            Grow();
+        }
+        const uint64_t key = Pack(from, to);
+        Slot& slot = slots_[Probe(key)];
+        if (slot.key == EMPTY){
+            slot = {key, distance};
+            ++size_;
+        }
+    }
+
+    std::optional<int> DistanceTable::Find(domain::StopId from, domain::StopId to) const {
+        if (slots_.empty()){
+            return std::nullopt;
+        }
+        if (const Slot& slot = slots_[Probe(Pack(from, to))]; slot.key != EMPTY){
+            return slot.distance;
+        }
+        if (const Slot& slot = slots_[Probe(Pack(to, from))]; slot.key != EMPTY){
+            return slot.distance;
+        }
+        return std::nullopt;
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "domain.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+
+namespace transport_directory {
+
+    // Road distances between ordered pairs of stops, in one flat open-addressing table.
+    // A pair is packed into a 64-bit key, mixed and probed linearly in a power-of-two
+    // array kept at most half full, so a lookup is one slot read in most cases and never
+    // follows a node pointer.
+    class DistanceTable {
+    public:
+        // Keeps the first distance given for a pair; a repeated pair is ignored.
+        void Insert(domain::StopId from, domain::StopId to, int distance);
+
+        // The distance given from from to to, else the one given from to to from.
+        std::optional<int> Find(domain::StopId from, domain::StopId to) const;
+
+        size_t size() const {
+            return size_;
+        }
+
+    private:
+        // The key of no pair: both halves are the id of no stop.
+        static constexpr uint64_t EMPTY = std::numeric_limits<uint64_t>::max();
+        static constexpr size_t MIN_CAPACITY = 16;
+
+        struct Slot {
+            uint64_t key = EMPTY;
+            int distance = 0;
+        };
+
+        static uint64_t Pack(domain::StopId from, domain::StopId to);
+        // The slot holding key, or the empty slot where it would go.
+        size_t Probe(uint64_t key) const;
+        void Grow();
+
+        std::vector<Slot> slots_;
+        size_t size_ = 0;
+    };
+}
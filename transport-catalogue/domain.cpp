@@ -5,15 +5,7 @@ namespace domain {
             return name.empty();
         }
 
-    const std::unordered_set<Bus*>& Stop::GetBuses() const {
-        return buses;
-    }
-
     bool Bus::Empty() const {
         return name.empty();
     }
-
-    const std::deque<Stop*>& Bus::GetStops() const {
-        return stops;
-    }
 }
\ No newline at end of file
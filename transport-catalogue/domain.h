@@ -2,39 +2,111 @@
 
 #include "geo.h"
 
-#include <deque>
-#include <string>
-#include <unordered_set>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
 
 
 namespace domain {
-    struct Bus;
+    // Dense ids: a stop or bus is the position of its record in the catalogue.
+    using StopId = uint32_t;
+    using BusId = uint32_t;
 
     struct Stop {
         bool Empty() const;
 
-        const std::unordered_set<Bus *>& GetBuses() const;
-
-        std::string name;
+        std::string_view name;
         geo::Coordinates coordinates;
-        std::unordered_set<Bus *> buses;
+        StopId id = 0;
     };
 
     struct Bus {
         bool Empty() const;
-        const std::deque<Stop*>& GetStops() const;
 
-        Bus() = default;
-        Bus(const std::string& busname)
-            : name(busname){}
+        std::string_view name;
+        bool is_roundtrip_ = false;
+        BusId id = 0;
+    };
+
+    // Ids the catalogue keeps in one contiguous array, read as pointers to the records
+    // they index: walking a bus's stops touches an id array and the record table, not a
+    // node per stop.
+    template <typename Record, typename Id>
+    class RecordList {
+    public:
+        class Iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = const Record*;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const Record* const*;
+            using reference = const Record*;
+
+            Iterator(const Record* records, const Id* id)
+                : records_(records)
+                , id_(id){}
+
+            const Record* operator*() const {
+                return records_ + *id_;
+            }
+            Iterator& operator++(){
+                ++id_;
+                return *this;
+            }
+            bool operator==(const Iterator& other) const {
+                return id_ == other.id_;
+            }
+            bool operator!=(const Iterator& other) const {
+                return id_ != other.id_;
+            }
+
+        private:
+            const Record* records_;
+            const Id* id_;
+        };
+
+        RecordList() = default;
+        RecordList(const Record* records, const Id* begin, const Id* end)
+            : records_(records)
+            , begin_(begin)
+            , end_(end){}
+
+        Iterator begin() const {
+            return {records_, begin_};
+        }
+        Iterator end() const {
+            return {records_, end_};
+        }
+
+        size_t size() const {
+            return static_cast<size_t>(end_ - begin_);
+        }
+        bool empty() const {
+            return begin_ == end_;
+        }
+
+        const Record* operator[](size_t index) const {
+            return records_ + begin_[index];
+        }
+
+        const Id* GetIds() const {
+            return begin_;
+        }
+
+    private:
+        const Record* records_ = nullptr;
+        const Id* begin_ = nullptr;
+        const Id* end_ = nullptr;
+    };
 
-        Bus(const std::string& busname, bool is_roundtrip)
-            : name(busname)
-            , is_roundtrip_(is_roundtrip){}
+    using StopList = RecordList<Stop, StopId>;
+    using BusList = RecordList<Bus, BusId>;
 
-        std::string name;
-        std::deque<Stop*> stops;
-        bool is_roundtrip_;
+    // A bus with its stops in route order, as the map draws it.
+    struct BusRoute {
+        const Bus* bus;
+        StopList stops;
     };
 
 }
@@ -2,7 +2,10 @@
 
 #include "ranges.h"
 
+#include <cassert>
 #include <cstdlib>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace graph {
@@ -17,43 +20,98 @@ struct Edge {
     Weight weight;
 };
 
+// Moves items[i] to position new_ids[i] for every i, in place.
+template <typename T>
+void PermuteByIds(std::vector<T>& items, std::vector<EdgeId> new_ids) {
+    assert(items.size() == new_ids.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        while (new_ids[i] != i) {
+            const EdgeId target = new_ids[i];
+            std::swap(items[i], items[target]);
+            std::swap(new_ids[i], new_ids[target]);
+        }
+    }
+}
+
+// Edges are appended in any order while the graph is built. Freeze() then sorts them
+// by source into compressed sparse rows: the edges leaving a vertex become one run of
+// ids, so GetIncidentEdges is an id interval and a search reads the targets and weights
+// it relaxes from consecutive memory. Freezing renumbers edges, and adding an edge to
+// a frozen graph unfreezes it; incident edges can only be listed while frozen, and
+// GetIncidentEdges throws std::logic_error otherwise.
 template <typename Weight>
 class DirectedWeightedGraph {
 private:
-    using IncidenceList = std::vector<EdgeId>;
-    using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
+    using IncidentEdgesRange = ranges::Range<ranges::CountingIterator<EdgeId>>;
 
 public:
     DirectedWeightedGraph() = default;
     explicit DirectedWeightedGraph(size_t vertex_count);
     EdgeId AddEdge(const Edge<Weight>& edge);
+    // Returns the new id of each edge by the id it had before, for PermuteByIds on data
+    // kept per edge elsewhere; empty if the graph was already frozen.
+    std::vector<EdgeId> Freeze();
 
+    bool IsFrozen() const;
     size_t GetVertexCount() const;
     size_t GetEdgeCount() const;
     const Edge<Weight>& GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
 private:
+    size_t vertex_count_ = 0;
     std::vector<Edge<Weight>> edges_;
-    std::vector<IncidenceList> incidence_lists_;
+    // Edges of vertex v are [offsets_[v], offsets_[v + 1]); empty until frozen.
+    std::vector<EdgeId> offsets_;
 };
 
 template <typename Weight>
 DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-    : incidence_lists_(vertex_count) {
+    : vertex_count_(vertex_count) {
 }
 
 template <typename Weight>
 EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+    if (edge.from >= vertex_count_ || edge.to >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    offsets_.clear();
     edges_.push_back(edge);
-    const EdgeId id = edges_.size() - 1;
-    incidence_lists_.at(edge.from).push_back(id);
-    return id;
+    return edges_.size() - 1;
+}
+
+template <typename Weight>
+std::vector<EdgeId> DirectedWeightedGraph<Weight>::Freeze() {
+    if (IsFrozen()) {
+        return {};
+    }
+
+    offsets_.assign(vertex_count_ + 1, 0);
+    for (const auto& edge : edges_) {
+        ++offsets_[edge.from + 1];
+    }
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        offsets_[vertex + 1] += offsets_[vertex];
+    }
+
+    // A counting sort keeps the edges of a vertex in the order they were added.
+    std::vector<EdgeId> new_ids(edges_.size());
+    std::vector<EdgeId> next(offsets_.begin(), offsets_.end() - 1);
+    for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        new_ids[edge_id] = next[edges_[edge_id].from]++;
+    }
+    PermuteByIds(edges_, new_ids);
+    return new_ids;
+}
+
+template <typename Weight>
+bool DirectedWeightedGraph<Weight>::IsFrozen() const {
+    return !offsets_.empty();
 }
 
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-    return incidence_lists_.size();
+    return vertex_count_;
 }
 
 template <typename Weight>
@@ -69,6 +127,12 @@ const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const
 template <typename Weight>
 typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
 DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-    return ranges::AsRange(incidence_lists_.at(vertex));
+    if (!IsFrozen()) {
+        throw std::logic_error("Incident edges are listed before Freeze()");
+    }
+    if (vertex >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    return {ranges::CountingIterator<EdgeId>(offsets_[vertex]), ranges::CountingIterator<EdgeId>(offsets_[vertex + 1])};
 }
-}  // namespace graph
\ No newline at end of file
+}  // namespace graph
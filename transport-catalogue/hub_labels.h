@@ -0,0 +1,359 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Distance oracle on a 2-hop cover built by pruned landmark labeling. Every vertex keeps
+// an out label, hubs it reaches with their distances, and an in label, hubs reaching it;
+// the distance from s to t is the smallest out(s, h) + in(t, h) over hubs common to
+// both, found by merging two lists sorted by hub rank.
+//
+// Hubs are taken in decreasing degree order. Each one runs a forward and a backward
+// Dijkstra that skips vertices whose labels so far already cover the pair at no greater
+// distance, which keeps labels small. Entries also keep the edge they were reached by;
+// since a search only goes on from vertices it labeled, that edge always leads to a
+// vertex holding the same hub, and routes unpack by following it.
+template <typename Weight>
+class HubLabels final : public BaseRouter<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using Traits = WeightTraits<Weight>;
+    using Scalar = typename Traits::Scalar;
+
+    static_assert(std::numeric_limits<Scalar>::has_infinity,
+                  "Vertices not reached yet are kept at an infinite distance");
+
+public:
+    using RouteInfo = typename BaseRouter<Weight>::RouteInfo;
+    using SearchStats = typename BaseRouter<Weight>::SearchStats;
+    using IndexStats = typename BaseRouter<Weight>::IndexStats;
+
+    explicit HubLabels(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    std::optional<Weight> ComputeWeight(VertexId from, VertexId to) const override;
+
+    // settled_vertices counts label entries scanned.
+    SearchStats GetSearchStats() const override {
+        return {queries_.load(), settled_vertices_.load()};
+    }
+
+    // Both labels of all vertices together.
+    IndexStats GetIndexStats() const override;
+
+private:
+    using HubRank = uint32_t;
+    using ParentEdge = uint32_t;
+
+    static constexpr Scalar INFINITE_DISTANCE = std::numeric_limits<Scalar>::infinity();
+    // Parent edge of a hub's own entry.
+    static constexpr ParentEdge NO_EDGE = std::numeric_limits<ParentEdge>::max();
+
+    struct Entry {
+        HubRank hub;
+        Scalar distance;
+        ParentEdge parent_edge;
+    };
+
+    // Labels of all vertices, those of vertex v at [offsets[v], offsets[v + 1]). Parent
+    // edges are only read to unpack a route, so they are kept apart from what a merge scans.
+    struct Labels {
+        std::vector<size_t> offsets;
+        std::vector<HubRank> hubs;
+        std::vector<Scalar> distances;
+        std::vector<ParentEdge> parent_edges;
+
+        void Assign(std::vector<std::vector<Entry>>&& entries);
+        // Index of hub's entry in the label of vertex, which must have one.
+        size_t Find(VertexId vertex, HubRank hub) const;
+    };
+
+    struct Meeting {
+        Scalar distance = INFINITE_DISTANCE;
+        size_t out_index = 0;
+        size_t in_index = 0;
+    };
+
+    struct PruningState {
+        std::vector<Scalar> distances;
+        std::vector<ParentEdge> parent_edges;
+        std::vector<VertexId> reached;
+        // Distances of the hub's own label by hub rank.
+        std::vector<Scalar> hub_distances;
+    };
+
+    // Adds the hub of rank to the in labels of the vertices it reaches or, with
+    // is_reverse, to the out labels of the vertices reaching it.
+    void RunPrunedSearch(HubRank rank, bool is_reverse, PruningState& state,
+                         std::vector<std::vector<Entry>>& out_entries,
+                         std::vector<std::vector<Entry>>& in_entries) const;
+    Meeting FindMeeting(VertexId from, VertexId to) const;
+
+    const Graph& graph_;
+    // Vertex by hub rank.
+    std::vector<VertexId> hubs_;
+    // Incoming edges by target vertex, for the backward searches.
+    std::vector<size_t> in_offsets_;
+    std::vector<EdgeId> in_edges_;
+    Labels out_labels_;
+    Labels in_labels_;
+
+    mutable std::atomic<size_t> queries_{0};
+    mutable std::atomic<size_t> settled_vertices_{0};
+};
+
+template <typename Weight>
+HubLabels<Weight>::HubLabels(const Graph& graph)
+    : graph_(graph)
+    , hubs_(graph.GetVertexCount())
+    , in_offsets_(graph.GetVertexCount() + 1, 0)
+{
+    const size_t vertex_count = graph.GetVertexCount();
+    if (graph.GetEdgeCount() >= NO_EDGE) {
+        throw std::length_error("Too many edges for 32-bit edge ids");
+    }
+
+    std::vector<size_t> degrees(vertex_count, 0);
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        if (edge.weight < Weight{}) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        ++in_offsets_[edge.to + 1];
+        ++degrees[edge.from];
+        ++degrees[edge.to];
+    }
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        in_offsets_[vertex + 1] += in_offsets_[vertex];
+    }
+    in_edges_.resize(graph.GetEdgeCount());
+    std::vector<size_t> fill(in_offsets_.begin(), in_offsets_.end() - 1);
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        in_edges_[fill[graph.GetEdge(edge_id).to]++] = edge_id;
+    }
+
+    std::iota(hubs_.begin(), hubs_.end(), VertexId{0});
+    std::stable_sort(hubs_.begin(), hubs_.end(), [&degrees](VertexId lhs, VertexId rhs) {
+        return degrees[lhs] > degrees[rhs];
+    });
+
+    // Entries are appended in rank order, which keeps every label sorted by hub rank.
+    std::vector<std::vector<Entry>> out_entries(vertex_count);
+    std::vector<std::vector<Entry>> in_entries(vertex_count);
+    PruningState state;
+    state.distances.assign(vertex_count, INFINITE_DISTANCE);
+    state.parent_edges.assign(vertex_count, NO_EDGE);
+    state.hub_distances.assign(vertex_count, INFINITE_DISTANCE);
+    for (HubRank rank = 0; rank < vertex_count; ++rank) {
+        RunPrunedSearch(rank, false, state, out_entries, in_entries);
+        RunPrunedSearch(rank, true, state, out_entries, in_entries);
+    }
+
+    out_labels_.Assign(std::move(out_entries));
+    in_labels_.Assign(std::move(in_entries));
+}
+
+template <typename Weight>
+void HubLabels<Weight>::RunPrunedSearch(HubRank rank, bool is_reverse, PruningState& state,
+                                        std::vector<std::vector<Entry>>& out_entries,
+                                        std::vector<std::vector<Entry>>& in_entries) const {
+    const VertexId hub = hubs_[rank];
+    // A forward search labels the in labels of the vertices it reaches; a pair is covered
+    // by a hub in both the out label of the hub vertex and the in label of the vertex.
+    std::vector<std::vector<Entry>>& labeled = is_reverse ? out_entries : in_entries;
+    const std::vector<Entry>& hub_label = is_reverse ? in_entries[hub] : out_entries[hub];
+    for (const Entry& entry : hub_label) {
+        state.hub_distances[entry.hub] = entry.distance;
+    }
+
+    using Item = std::pair<Scalar, VertexId>;
+    std::vector<Item> heap{{Scalar{}, hub}};
+    state.distances[hub] = Scalar{};
+    state.reached.push_back(hub);
+    const auto relax = [&heap, &state](VertexId vertex, Scalar candidate, EdgeId edge_id) {
+        if (candidate < state.distances[vertex]) {
+            if (state.distances[vertex] == INFINITE_DISTANCE) {
+                state.reached.push_back(vertex);
+            }
+            state.distances[vertex] = candidate;
+            state.parent_edges[vertex] = static_cast<ParentEdge>(edge_id);
+            heap.push_back({candidate, vertex});
+            std::push_heap(heap.begin(), heap.end(), std::greater<Item>{});
+        }
+    };
+
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<Item>{});
+        const auto [distance, vertex] = heap.back();
+        heap.pop_back();
+        if (state.distances[vertex] < distance) {
+            continue;
+        }
+
+        std::vector<Entry>& label = labeled[vertex];
+        // The hub's own pair is never pruned: zero-weight cycles may cover it already.
+        if (vertex != hub) {
+            const bool is_covered = std::any_of(label.begin(), label.end(),
+                [&state, distance](const Entry& entry) {
+                    return !(distance < state.hub_distances[entry.hub] + entry.distance);
+                });
+            if (is_covered) {
+                continue;
+            }
+        }
+        label.push_back({rank, distance, vertex == hub ? NO_EDGE : state.parent_edges[vertex]});
+
+        if (is_reverse) {
+            for (size_t i = in_offsets_[vertex]; i < in_offsets_[vertex + 1]; ++i) {
+                const auto& edge = graph_.GetEdge(in_edges_[i]);
+                relax(edge.from, distance + Traits::ToScalar(edge.weight), in_edges_[i]);
+            }
+        } else {
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+                const auto& edge = graph_.GetEdge(edge_id);
+                relax(edge.to, distance + Traits::ToScalar(edge.weight), edge_id);
+            }
+        }
+    }
+
+    for (const VertexId vertex : state.reached) {
+        state.distances[vertex] = INFINITE_DISTANCE;
+        state.parent_edges[vertex] = NO_EDGE;
+    }
+    state.reached.clear();
+    for (const Entry& entry : hub_label) {
+        state.hub_distances[entry.hub] = INFINITE_DISTANCE;
+    }
+}
+
+template <typename Weight>
+void HubLabels<Weight>::Labels::Assign(std::vector<std::vector<Entry>>&& entries) {
+    offsets.assign(entries.size() + 1, 0);
+    for (size_t vertex = 0; vertex < entries.size(); ++vertex) {
+        offsets[vertex + 1] = offsets[vertex] + entries[vertex].size();
+    }
+    hubs.reserve(offsets.back());
+    distances.reserve(offsets.back());
+    parent_edges.reserve(offsets.back());
+    for (auto& label : entries) {
+        for (const Entry& entry : label) {
+            hubs.push_back(entry.hub);
+            distances.push_back(entry.distance);
+            parent_edges.push_back(entry.parent_edge);
+        }
+        label = {};
+    }
+}
+
+template <typename Weight>
+size_t HubLabels<Weight>::Labels::Find(VertexId vertex, HubRank hub) const {
+    const auto begin = hubs.begin() + offsets[vertex];
+    const auto end = hubs.begin() + offsets[vertex + 1];
+    const auto it = std::lower_bound(begin, end, hub);
+    if (it == end || *it != hub) {
+        throw std::logic_error("Hub label has no entry on the route");
+    }
+    return static_cast<size_t>(it - hubs.begin());
+}
+
+template <typename Weight>
+typename HubLabels<Weight>::Meeting HubLabels<Weight>::FindMeeting(VertexId from, VertexId to) const {
+    const size_t vertex_count = hubs_.size();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    Meeting meeting;
+    size_t out_index = out_labels_.offsets[from];
+    size_t in_index = in_labels_.offsets[to];
+    const size_t out_end = out_labels_.offsets[from + 1];
+    const size_t in_end = in_labels_.offsets[to + 1];
+    const size_t scanned = (out_end - out_index) + (in_end - in_index);
+    while (out_index < out_end && in_index < in_end) {
+        const HubRank out_hub = out_labels_.hubs[out_index];
+        const HubRank in_hub = in_labels_.hubs[in_index];
+        if (out_hub < in_hub) {
+            ++out_index;
+        } else if (in_hub < out_hub) {
+            ++in_index;
+        } else {
+            const Scalar distance = out_labels_.distances[out_index] + in_labels_.distances[in_index];
+            if (distance < meeting.distance) {
+                meeting = {distance, out_index, in_index};
+            }
+            ++out_index;
+            ++in_index;
+        }
+    }
+
+    ++queries_;
+    settled_vertices_ += scanned;
+    return meeting;
+}
+
+template <typename Weight>
+std::optional<Weight> HubLabels<Weight>::ComputeWeight(VertexId from, VertexId to) const {
+    const Meeting meeting = FindMeeting(from, to);
+    if (meeting.distance == INFINITE_DISTANCE) {
+        return std::nullopt;
+    }
+    return Traits::FromScalar(meeting.distance);
+}
+
+template <typename Weight>
+std::optional<typename HubLabels<Weight>::RouteInfo> HubLabels<Weight>::BuildRoute(VertexId from,
+                                                                                   VertexId to) const {
+    const Meeting meeting = FindMeeting(from, to);
+    if (meeting.distance == INFINITE_DISTANCE) {
+        return std::nullopt;
+    }
+    const HubRank hub = out_labels_.hubs[meeting.out_index];
+
+    std::vector<EdgeId> edges;
+    for (size_t index = meeting.out_index; out_labels_.parent_edges[index] != NO_EDGE;) {
+        const EdgeId edge_id = out_labels_.parent_edges[index];
+        edges.push_back(edge_id);
+        index = out_labels_.Find(graph_.GetEdge(edge_id).to, hub);
+    }
+    const size_t hub_position = edges.size();
+    for (size_t index = meeting.in_index; in_labels_.parent_edges[index] != NO_EDGE;) {
+        const EdgeId edge_id = in_labels_.parent_edges[index];
+        edges.push_back(edge_id);
+        index = in_labels_.Find(graph_.GetEdge(edge_id).from, hub);
+    }
+    std::reverse(edges.begin() + hub_position, edges.end());
+
+    return RouteInfo{Traits::FromScalar(meeting.distance), std::move(edges)};
+}
+
+template <typename Weight>
+typename HubLabels<Weight>::IndexStats HubLabels<Weight>::GetIndexStats() const {
+    IndexStats stats;
+    for (const Labels* labels : {&out_labels_, &in_labels_}) {
+        stats.entries += labels -> hubs.size();
+        stats.bytes += labels -> offsets.size() * sizeof(size_t)
+            + labels -> hubs.size() * (sizeof(HubRank) + sizeof(Scalar) + sizeof(ParentEdge));
+    }
+    for (VertexId vertex = 0; vertex < hubs_.size(); ++vertex) {
+        stats.max_vertex_entries = std::max(stats.max_vertex_entries,
+            out_labels_.offsets[vertex + 1] - out_labels_.offsets[vertex]
+            + in_labels_.offsets[vertex + 1] - in_labels_.offsets[vertex]);
+    }
+    return stats;
+}
+
+}
@@ -329,7 +329,11 @@ Document Load(std::istream& input) {
 }
 
 void Print(const Document& doc, std::ostream& output) {
-    PrintNode(doc.GetRoot(), PrintContext{output});
+    Print(doc.GetRoot(), output);
+}
+
+void Print(const Node& node, std::ostream& output) {
+    PrintNode(node, PrintContext{output});
 }
 
 }  // namespace json
\ No newline at end of file
@@ -149,4 +149,6 @@ Document Load(std::istream& input);
 
 void Print(const Document& doc, std::ostream& output);
 
+void Print(const Node& node, std::ostream& output);
+
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "json_reader.h"
+#include "router_storage.h"
 
+#include <algorithm>
 #include <sstream>
 
 
@@ -81,6 +83,7 @@ namespace json_reader {
         } else {
             throw std::invalid_argument("No base requests"s);
         }
+        db.Freeze();
 
         return db;
     }
@@ -151,18 +154,16 @@ namespace json_reader {
         builder.StartDict();
         builder.Key("request_id"s).Value(request.at("id"s).AsInt()); 
         std::string_view name = request.at("name"s).AsString();
-        if (handler.GetBusByName(name) -> Empty()){
+        const Bus* bus = handler.GetBusByName(name);
+        if (bus -> Empty()){
             builder.Key("error_message"s).Value("not found"s);
         } else {
-            const auto& bus = handler.GetBusByName(name);
-            const double geo_dist = RootDistance(bus -> GetStops());
-            const int real_dist = handler.GetRealDistance(bus -> GetStops());
-            std::unordered_set<Stop *> unique_stops{bus -> stops.begin(), bus -> stops.end()};
-
-            builder.Key("route_length"s).Value(real_dist);
-            builder.Key("stop_count"s).Value(static_cast<int>(bus -> stops.size()));
-            builder.Key("unique_stop_count"s).Value(static_cast<int>(unique_stops.size()));
-            builder.Key("curvature"s).Value(real_dist / geo_dist);
+            const BusStats& stats = handler.GetBusStats(*bus);
+
+            builder.Key("route_length"s).Value(stats.route_length);
+            builder.Key("stop_count"s).Value(stats.stop_count);
+            builder.Key("unique_stop_count"s).Value(stats.unique_stop_count);
+            builder.Key("curvature"s).Value(stats.curvature);
         }
         builder.EndDict();
    }
@@ -178,17 +179,15 @@ namespace json_reader {
         if (handler.GetStopByName(name) -> Empty()){
             builder.Key("error_message"s).Value("not found"s);
         } else {
-            const Stop* stop = handler.GetStopByName(name);
+            // The catalogue keeps every stop's buses sorted by name.
+            const BusList stop_buses = handler.GetStopBuses(name);
             Array buses;
-            for (const auto bus : stop -> GetBuses()){
-                buses.push_back(bus -> name);
+            buses.reserve(stop_buses.size());
+            for (const auto bus : stop_buses){
+                buses.push_back(std::string(bus -> name));
             }
 
-            std::sort(buses.begin(), buses.end(), [](const auto& lhs, const auto& rhs){
-                return lhs.AsString() < rhs.AsString();
-            });
-
-            builder.Key("buses"s).Value(buses);
+            builder.Key("buses"s).Value(std::move(buses));
         }
         builder.EndDict();
     }
@@ -207,6 +206,35 @@ namespace json_reader {
         builder.EndDict();
     }
 
+    void AddRouteItems(json::Builder& builder, const std::vector<RouteItem>& items){
+        builder.StartArray();
+        for (const auto& item : items){
+            builder.StartDict();
+            builder.Key("type"s);
+            if (item.type == RoutesType::BUS){
+                builder.Value("Bus"s);
+                builder.Key("bus"s).Value(std::string(item.name));
+                builder.Key("span_count"s).Value(item.span_count);
+            } else {
+                builder.Value("Wait"s);
+                builder.Key("stop_name"s).Value(std::string(item.name));
+            }
+
+            builder.Key("time"s).Value(item.time);
+            builder.EndDict();
+        }
+        builder.EndArray();
+    }
+
+    std::vector<std::string_view> GetStopNames(const json::Array& stops){
+        std::vector<std::string_view> names;
+        names.reserve(stops.size());
+        for (const auto& stop : stops){
+            names.push_back(stop.AsString());
+        }
+        return names;
+    }
+
     void JSONReader::RouteRequest(
             json::Builder& builder,
             const json::Dict& request,
@@ -223,23 +251,56 @@ namespace json_reader {
         if (!route){
             builder.Key("error_message"s).Value("not found"s);
         } else {
-            builder.Key("total_time"s).Value(route -> weight.time_);
-            builder.Key("items"s).StartArray();
-            for (auto edge_id : route -> edges){
-                const auto& edge = handler.GetHelper().GetEdge(edge_id).weight;
-                builder.StartDict();
-                builder.Key("type"s);
-                if (edge.action_ == RoutesType::BUS){
-                    builder.Value("Bus"s);
-                    builder.Key("bus"s).Value(std::string(edge.name_));
-                    builder.Key("span_count"s).Value(edge.span_counter);
+            builder.Key("total_time"s).Value(route -> total_time);
+            builder.Key("items"s);
+            AddRouteItems(builder, route -> items);
+        }
+
+        builder.EndDict();
+    }
+
+    void JSONReader::RouteMatrixRequest(
+            json::Builder& builder,
+            const json::Dict& request,
+            const request_handler::RequestHandler& handler
+        ) const
+    {
+        builder.StartDict();
+        builder.Key("request_id"s).Value(request.at("id"s).AsInt());
+        const bool with_items = request.count("with_items"s) != 0
+            && request.at("with_items"s).AsBool();
+        const auto matrix = handler.GetRouteMatrix(
+            GetStopNames(request.at("from"s).AsArray()),
+            GetStopNames(request.at("to"s).AsArray()),
+            with_items
+        );
+
+        builder.Key("total_times"s).StartArray();
+        for (const auto& row : matrix){
+            builder.StartArray();
+            for (const auto& route : row){
+                if (route){
+                    builder.Value(route -> total_time);
                 } else {
-                    builder.Value("Wait"s);
-                    builder.Key("stop_name"s).Value(std::string(edge.name_));
+                    builder.Value(nullptr);
                 }
+            }
+            builder.EndArray();
+        }
+        builder.EndArray();
 
-                builder.Key("time"s).Value(edge.time_);
-                builder.EndDict();
+        if (with_items){
+            builder.Key("items"s).StartArray();
+            for (const auto& row : matrix){
+                builder.StartArray();
+                for (const auto& route : row){
+                    if (route){
+                        AddRouteItems(builder, route -> items);
+                    } else {
+                        builder.Value(nullptr);
+                    }
+                }
+                builder.EndArray();
             }
             builder.EndArray();
         }
@@ -247,25 +308,69 @@ namespace json_reader {
         builder.EndDict();
     }
 
-    void JSONReader::ManageRequests(std::ostream& out, const request_handler::RequestHandler& handler) const {
+    bool JSONReader::HasRouteRequests() const {
+        const Array& requests = doc_.GetRoot().AsDict().at("stat_requests"s).AsArray();
+        return std::any_of(requests.begin(), requests.end(), [](const Node& request){
+            const std::string& type = request.AsDict().at("type"s).AsString();
+            return type == "Route"s || type == "RouteMatrix"s;
+        });
+    }
 
+    std::optional<Node> JSONReader::HandleRequest(
+            const json::Dict& request,
+            const request_handler::RequestHandler& handler
+        ) const
+    {
         json::Builder builder = json::Builder{};
-        builder.StartArray();
+        const std::string& type = request.at("type"s).AsString();
+        if (type == "Bus"s){
+            BusRequest(builder, request, handler);
+        } else if (type == "Stop"s) {
+            StopRequest(builder, request, handler);
+        } else if (type == "Map"s){
+            MapRequest(builder, request, handler);
+        } else if (type == "Route"s){
+            RouteRequest(builder, request, handler);
+        } else if (type == "RouteMatrix"s){
+            RouteMatrixRequest(builder, request, handler);
+        } else {
+            return std::nullopt;
+        }
+        return builder.Build();
+    }
 
-        for (const auto& request : doc_.GetRoot().AsDict().at("stat_requests"s).AsArray()){
-            const Dict& dict = request.AsDict();
-            if (dict.at("type"s).AsString() == "Bus"s){
-                BusRequest(builder, dict, handler);
-            } else if (dict.at("type"s).AsString() == "Stop"s) {
-                StopRequest(builder, dict, handler);
-            } else if (dict.at("type"s).AsString() == "Map"s){
-                MapRequest(builder, dict, handler);
-            } else if (dict.at("type"s).AsString() == "Route"s){
-                RouteRequest(builder, dict, handler);
+    void JSONReader::ManageRequests(std::ostream& out, const request_handler::RequestHandler& handler,
+                                    size_t thread_count) const {
+        const Array& requests = doc_.GetRoot().AsDict().at("stat_requests"s).AsArray();
+
+        // Requests only read the handler, so each one builds its answer on its own and the
+        // answers are put back in request order afterwards.
+        std::vector<std::optional<Node>> responses(requests.size());
+        parallel::ThreadPool pool(thread_count);
+        pool.ParallelFor(requests.size(), [this, &requests, &responses, &handler](size_t index){
+            responses[index] = HandleRequest(requests[index].AsDict(), handler);
+        });
+
+        Array result;
+        result.reserve(responses.size());
+        for (auto& response : responses){
+            if (response){
+                result.push_back(std::move(*response));
             }
         }
-        builder.EndArray();
-        Print(Document{builder.Build()}, out);
+        Print(Document{Node{std::move(result)}}, out);
+   }
+
+   namespace {
+        // A count setting, which must be at least minimum.
+        size_t ReadCount(const json::Dict& settings, const std::string& key, int minimum){
+            const int value = settings.at(key).AsInt();
+            if (value < minimum){
+                throw std::invalid_argument("Setting "s + key + " must be at least "s
+                                            + std::to_string(minimum) + ", got "s + std::to_string(value));
+            }
+            return static_cast<size_t>(value);
+        }
    }
 
    RoutingSettings JSONReader::GetRoutingSettings() const {
@@ -273,6 +378,67 @@ namespace json_reader {
         const auto& dict_settings = doc_.GetRoot().AsDict().at("routing_settings"s).AsDict();
         settings.bus_wait_time = dict_settings.at("bus_wait_time"s).AsInt();
         settings.bus_velocity = dict_settings.at("bus_velocity"s).AsInt();
+        if (dict_settings.count("router"s) != 0){
+            const std::string& router = dict_settings.at("router"s).AsString();
+            if (router == "all_pairs"s){
+                settings.router_type = RouterType::ALL_PAIRS;
+            } else if (router == "dijkstra"s){
+                settings.router_type = RouterType::DIJKSTRA;
+            } else if (router == "contraction_hierarchy"s){
+                settings.router_type = RouterType::CONTRACTION_HIERARCHY;
+            } else if (router == "alt"s){
+                settings.router_type = RouterType::ALT;
+            } else if (router == "hub_labels"s){
+                settings.router_type = RouterType::HUB_LABELS;
+            } else if (router == "raptor"s){
+                settings.router_type = RouterType::RAPTOR;
+            } else if (router == "auto"s){
+                settings.router_type = RouterType::AUTO;
+            } else {
+                throw std::invalid_argument("Unknown router: "s + router);
+            }
+        }
+        if (dict_settings.count("memory_budget_mb"s) != 0){
+            settings.memory_budget_mb = ReadCount(dict_settings, "memory_budget_mb"s, 0);
+            // A budget alone asks for the router that fits it.
+            if (dict_settings.count("router"s) == 0){
+                settings.router_type = RouterType::AUTO;
+            }
+        }
+        if (dict_settings.count("graph_model"s) != 0){
+            const std::string& model = dict_settings.at("graph_model"s).AsString();
+            if (model == "complete"s){
+                settings.graph_model = GraphModel::COMPLETE;
+            } else if (model == "route_pattern"s){
+                settings.graph_model = GraphModel::ROUTE_PATTERN;
+            } else {
+                throw std::invalid_argument("Unknown graph model: "s + model);
+            }
+        }
+        if (dict_settings.count("route_cache_size"s) != 0){
+            settings.route_cache_size = ReadCount(dict_settings, "route_cache_size"s, 0);
+        }
+        if (dict_settings.count("landmark_count"s) != 0){
+            settings.landmark_count = ReadCount(dict_settings, "landmark_count"s, 1);
+        }
+        if (dict_settings.count("route_edges"s) != 0){
+            const std::string& route_edges = dict_settings.at("route_edges"s).AsString();
+            if (route_edges == "last"s){
+                settings.route_edges = graph::RouteEdges::LAST;
+            } else if (route_edges == "first"s){
+                settings.route_edges = graph::RouteEdges::FIRST;
+            } else {
+                throw std::invalid_argument("Unknown route edges: "s + route_edges);
+            }
+        }
+        if (dict_settings.count("precompute_file"s) != 0){
+            settings.precompute_file = dict_settings.at("precompute_file"s).AsString();
+
+            std::ostringstream input;
+            Print(doc_.GetRoot().AsDict().at("base_requests"s), input);
+            Print(doc_.GetRoot().AsDict().at("routing_settings"s), input);
+            settings.input_hash = router_storage::Hash(input.str());
+        }
         return settings;
    }
 }
\ No newline at end of file
@@ -3,9 +3,12 @@
 #include "json_builder.h"
 #include "map_renderer.h"
 #include "request_handler.h"
+#include "thread_pool.h"
 #include "transport_catalogue.h"
 #include "transport_router.h"
 
+#include <optional>
+
 
 namespace json_reader{
     using namespace transport_directory;
@@ -53,6 +56,24 @@ namespace json_reader{
             const request_handler::RequestHandler& handler
         ) const;
 
-        void ManageRequests(std::ostream& out, const request_handler::RequestHandler& handler) const;
+        void RouteMatrixRequest(
+            json::Builder& builder,
+            const json::Dict& request,
+            const request_handler::RequestHandler& handler
+        ) const;
+
+        // Whether any of stat_requests needs the routers.
+        bool HasRouteRequests() const;
+
+        // Answers stat_requests on thread_count threads, printed in request order. Types
+        // it does not know get no answer.
+        void ManageRequests(std::ostream& out, const request_handler::RequestHandler& handler,
+                            size_t thread_count = parallel::DefaultThreadCount()) const;
+
+    private:
+        std::optional<json::Node> HandleRequest(
+            const json::Dict& request,
+            const request_handler::RequestHandler& handler
+        ) const;
     };
 }
\ No newline at end of file
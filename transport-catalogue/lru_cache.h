@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+
+namespace cache {
+
+    struct CacheStats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t size = 0;
+        size_t capacity = 0;
+    };
+
+    // Bounded least-recently-used map guarded by a mutex. A capacity of zero disables it:
+    // nothing is stored and every lookup counts as a miss.
+    template <typename Key, typename Value, typename Hash = std::hash<Key>>
+    class LruCache {
+    public:
+        explicit LruCache(size_t capacity)
+            : capacity_(capacity){
+            // The index grows with the entries past this, so a large capacity costs nothing
+            // until it is used.
+            index_.reserve(std::min(capacity, MAX_RESERVED));
+        }
+
+        std::optional<Value> Get(const Key& key) {
+            std::lock_guard lock(mutex_);
+            const auto it = index_.find(key);
+            if (it == index_.end()){
+                ++misses_;
+                return std::nullopt;
+            }
+            ++hits_;
+            entries_.splice(entries_.begin(), entries_, it -> second);
+            return it -> second -> second;
+        }
+
+        void Put(const Key& key, Value value) {
+            if (capacity_ == 0){
+                return;
+            }
+            std::lock_guard lock(mutex_);
+            if (const auto it = index_.find(key); it != index_.end()){
+                it -> second -> second = std::move(value);
+                entries_.splice(entries_.begin(), entries_, it -> second);
+                return;
+            }
+            if (entries_.size() == capacity_){
+                index_.erase(entries_.back().first);
+                entries_.pop_back();
+            }
+            entries_.emplace_front(key, std::move(value));
+            index_[key] = entries_.begin();
+        }
+
+        CacheStats GetStats() const {
+            std::lock_guard lock(mutex_);
+            return {hits_, misses_, entries_.size(), capacity_};
+        }
+
+    private:
+        using Entries = std::list<std::pair<Key, Value>>;
+
+        static constexpr size_t MAX_RESERVED = 4096;
+
+        const size_t capacity_;
+        Entries entries_;
+        std::unordered_map<Key, typename Entries::iterator, Hash> index_;
+        size_t hits_ = 0;
+        size_t misses_ = 0;
+        mutable std::mutex mutex_;
+    };
+}
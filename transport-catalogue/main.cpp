@@ -1,17 +1,125 @@
 #include "request_handler.h"
 #include "json_reader.h"
+#include "thread_pool.h"
 #include "transport_router.h"
 
+#include <algorithm>
+#include <chrono>
+#include <future>
 #include <iostream>
+#include <sstream>
+#include <string_view>
+#include <type_traits>
 
 
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince(Clock::time_point origin, Clock::time_point moment){
+        return std::chrono::duration<double, std::milli>(moment - origin).count();
+    }
+
+    // Runs one startup stage and logs its wall time together with when it started and
+    // finished since origin, so that stages run side by side show the critical path.
+    template <typename Stage>
+    auto RunStage(std::string_view name, Clock::time_point origin, Stage&& stage){
+        const auto start = Clock::now();
+        const auto log = [name, origin, start](){
+            const auto finish = Clock::now();
+            std::ostringstream line;
+            line << "stage " << name << ": " << MillisecondsSince(start, finish) << " ms ("
+                 << MillisecondsSince(origin, start) << " - " << MillisecondsSince(origin, finish) << ")\n";
+            std::cerr << line.str();
+        };
+        if constexpr (std::is_void_v<std::invoke_result_t<Stage>>){
+            stage();
+            log();
+        } else {
+            auto result = stage();
+            log();
+            return result;
+        }
+    }
+}
+
 int main(){
+    const auto origin = Clock::now();
+    parallel::ThreadPool pool;
+
     json_reader::JSONReader rd;
-    rd.Read(std::cin);
-    const map_render::RenderSVG render(rd.GetRenderSettings());
-    const transport_directory::TransportCatalogue db = rd.GetDB();
-    RouterHelper helper{rd.GetRoutingSettings(), db.GetAllStops().size()};
-    helper.LoadGraph(db);
-    request_handler::RequestHandler handler{db, render, helper};
-    rd.ManageRequests(std::cout, handler);
-}
\ No newline at end of file
+    RunStage("read", origin, [&rd](){ rd.Read(std::cin); });
+
+    // The renderer needs nothing but its settings, so it is prepared next to the catalogue.
+    auto render = pool.Submit([&rd, origin](){
+        return RunStage("renderer", origin, [&rd](){ return map_render::RenderSVG(rd.GetRenderSettings()); });
+    });
+    const RoutingSettings settings = rd.GetRoutingSettings();
+    const transport_directory::TransportCatalogue db = RunStage("catalogue", origin, [&rd](){ return rd.GetDB(); });
+    const auto names = db.GetNameStats();
+    std::cerr << "names: "
+              << names.names << " given, " << names.unique << " stored, "
+              << names.interned_bytes << " bytes interned against "
+              << names.string_bytes << " as strings, "
+              << static_cast<long long>(names.string_bytes) - static_cast<long long>(names.interned_bytes)
+              << " saved" << std::endl;
+
+    // The graph and the routers are built once, by the first request that routes.
+    RouterHelper helper{settings, db.GetAllStops().size()};
+    const auto make_routers = [&helper, &db, &settings, origin](){
+        RunStage("graph", origin, [&helper, &db](){ helper.LoadGraph(db); });
+        request_handler::Routers routers;
+        if (settings.router_type != RouterType::RAPTOR){
+            const auto components = helper.GetComponents().GetStats();
+            std::cerr << "components: "
+                      << components.strong_count << " strong, largest " << components.largest_strong << " vertices, "
+                      << components.single_vertex << " of one vertex; "
+                      << components.weak_count << " weak, largest " << components.largest_weak << " vertices" << std::endl;
+        }
+        if (settings.router_type == RouterType::RAPTOR){
+            routers.raptor = RunStage("raptor", origin, [&db, &settings](){
+                return request_handler::RequestHandler::MakeRaptorRouter(db, settings);
+            });
+        } else {
+            routers.router = RunStage("router", origin, [&helper](){ return helper.BuildRouter(); });
+            const auto index = routers.router -> GetIndexStats();
+            if (index.entries != 0){
+                std::cerr << "router index: "
+                          << index.entries << " entries, "
+                          << static_cast<double>(index.entries) / static_cast<double>(std::max<size_t>(helper.GetGraph().GetVertexCount(), 1))
+                          << " per vertex, at most " << index.max_vertex_entries << ", "
+                          << index.bytes / 1024 << " KB" << std::endl;
+            }
+        }
+        return routers;
+    };
+    const map_render::RenderSVG renderer = render.get();
+    const request_handler::RequestHandler handler{db, renderer, helper, make_routers};
+
+    // A batch known to route starts on the routers right away, next to the requests that
+    // do not need them.
+    std::future<void> routers;
+    if (rd.HasRouteRequests()){
+        routers = pool.Submit([&handler](){ handler.PrepareRouters(); });
+    }
+    RunStage("requests", origin, [&rd, &handler](){ rd.ManageRequests(std::cout, handler); });
+    if (routers.valid()){
+        routers.get();
+    }
+
+    const auto route_cache = handler.GetRouteCacheStats();
+    if (route_cache.hits + route_cache.misses != 0){
+        std::cerr << "route cache: "
+                  << route_cache.hits << " hits, "
+                  << route_cache.misses << " misses, "
+                  << route_cache.size << '/' << route_cache.capacity << " entries" << std::endl;
+    }
+
+    const auto router_stats = handler.GetRouterStats();
+    if (router_stats.queries != 0){
+        std::cerr << "router: "
+                  << router_stats.queries << " searches, "
+                  << router_stats.settled_vertices << " vertices settled, "
+                  << static_cast<double>(router_stats.settled_vertices) / static_cast<double>(router_stats.queries)
+                  << " per search" << std::endl;
+    }
+}
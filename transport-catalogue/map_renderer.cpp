@@ -65,7 +65,7 @@ namespace map_render {
     };
 
     void RenderSVG::AddLines(
-        svg::Document& doc, const std::deque<domain::Bus*>& buses,
+        svg::Document& doc, const std::vector<domain::BusRoute>& buses,
         const SphereProjector& projector
     ) const {
         for (size_t i = 0; i < buses.size(); ++i){
@@ -74,7 +74,7 @@ namespace map_render {
                 .SetStrokeLineCap(svg::StrokeLineCap::ROUND).SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
 
             lines.SetStrokeColor(settings_.color_palette_[i % settings_.color_palette_.size()]);
-            for (const auto stop : buses.at(i) -> stops){
+            for (const auto stop : buses.at(i).stops){
                     auto point = projector(stop -> coordinates);
                     lines.AddPoint(point);
             }
@@ -83,7 +83,7 @@ namespace map_render {
     }
 
     void RenderSVG::AddBusesNames(
-        svg::Document& doc, const std::deque<domain::Bus*> buses,
+        svg::Document& doc, const std::vector<domain::BusRoute>& buses,
         const SphereProjector& projector) const
     {
         svg::Text text1, text2;
@@ -101,26 +101,27 @@ namespace map_render {
         text1.SetFillColor(settings_.underlayer_color_);
 
         for (size_t i = 0; i < buses.size(); ++i){
-            const auto& bus = buses.at(i);
-            const auto& first = bus -> stops.begin();
-            const auto coordinates = projector((*first) -> coordinates);
+            const auto& bus = buses.at(i).bus;
+            const auto& stops = buses.at(i).stops;
+            const auto first = stops[0];
+            const auto coordinates = projector(first -> coordinates);
 
-            text1.SetData(bus -> name);
+            text1.SetData(std::string(bus -> name));
             text1.SetPosition(coordinates);
             doc.Add(text1);
 
             text2.SetFillColor(settings_.color_palette_[i % settings_.color_palette_.size()]);
             text2.SetPosition(coordinates);
-            text2.SetData(bus -> name);
+            text2.SetData(std::string(bus -> name));
             doc.Add(text2);
 
             if (!bus -> is_roundtrip_){
-                const auto mid = std::next(first, static_cast<int>((bus -> stops.size() /2)));
-                if ((*first) != (*mid)){
-                    text1.SetPosition(projector((*mid) -> coordinates));
+                const auto mid = stops[stops.size() / 2];
+                if (first != mid){
+                    text1.SetPosition(projector(mid -> coordinates));
                     doc.Add(text1);
 
-                    text2.SetPosition(projector((*mid) -> coordinates));
+                    text2.SetPosition(projector(mid -> coordinates));
                     doc.Add(text2);
                 }
             }
@@ -129,7 +130,7 @@ namespace map_render {
 
 
     void RenderSVG::AddStopsSymbols(
-        svg::Document& doc, const std::deque<domain::Stop*> stops,
+        svg::Document& doc, const std::vector<const domain::Stop*>& stops,
         const SphereProjector& projector
     ) const {
         svg::Circle circle;
@@ -143,7 +144,7 @@ namespace map_render {
 
 
     void RenderSVG::AddStopsName(
-        svg::Document& doc, const std::deque<domain::Stop*> stops,
+        svg::Document& doc, const std::vector<const domain::Stop*>& stops,
         const SphereProjector& projector
     ) const {
         svg::Text text1, text2;
@@ -163,11 +164,11 @@ namespace map_render {
 
         for (const auto& stop : stops){
             const svg::Point coordinates = projector(stop -> coordinates);
-            text1.SetData(stop -> name);
+            text1.SetData(std::string(stop -> name));
             text1.SetPosition(coordinates);
             doc.Add(text1);
 
-            text2.SetData(stop -> name);
+            text2.SetData(std::string(stop -> name));
             text2.SetPosition(coordinates);
             doc.Add(text2);
         }
@@ -176,8 +177,8 @@ namespace map_render {
 
     void RenderSVG::RenderMap(
         std::ostream& out,
-        const std::deque<domain::Bus*>& buses,
-        const std::deque<domain::Stop*>& stops)
+        const std::vector<domain::BusRoute>& buses,
+        const std::vector<const domain::Stop*>& stops)
     const {
         const SphereProjector projector{
             stops.begin(), stops.end(),
@@ -43,22 +43,22 @@ private:
     const RenderSettings settings_;
 
     void AddLines(
-        svg::Document& doc, const std::deque<domain::Bus*>& buses,
+        svg::Document& doc, const std::vector<domain::BusRoute>& buses,
         const SphereProjector& projector
     ) const;
 
     void AddBusesNames(
-        svg::Document& doc, const std::deque<domain::Bus*> buses,
+        svg::Document& doc, const std::vector<domain::BusRoute>& buses,
         const SphereProjector& projector
     ) const;
 
     void AddStopsSymbols(
-        svg::Document& doc, const std::deque<domain::Stop*> buses,
+        svg::Document& doc, const std::vector<const domain::Stop*>& stops,
         const SphereProjector& projector
     ) const;
 
     void AddStopsName(
-        svg::Document& doc, const std::deque<domain::Stop*> buses,
+        svg::Document& doc, const std::vector<const domain::Stop*>& stops,
         const SphereProjector& projector
     ) const;
 
@@ -68,8 +68,8 @@ public:
 
     void RenderMap(
         std::ostream& out,
-        const std::deque<domain::Bus*>& buses,
-        const std::deque<domain::Stop*>& stops
+        const std::vector<domain::BusRoute>& buses,
+        const std::vector<const domain::Stop*>& stops
     ) const;
 };
 
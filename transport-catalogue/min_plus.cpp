@@ -0,0 +1,235 @@
+#include "min_plus.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MIN_PLUS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace graph::min_plus {
+
+namespace {
+
+// Implementations of the row update.
+enum class Kernel {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+// Where an improved cell takes its edge from: the same column of the pivot row, for
+// last edges, or one edge for the whole row, for first edges.
+struct PivotEdges {
+    const uint32_t* edges;
+
+    uint32_t Get(size_t i) const {
+        return edges[i];
+    }
+
+#ifdef MIN_PLUS_X86
+    __m128i Load2(size_t i) const {
+        return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(edges + i));
+    }
+
+    __m128i Load4(size_t i) const {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(edges + i));
+    }
+
+    __attribute__((target("avx2")))
+    __m256i Load8(size_t i) const {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(edges + i));
+    }
+#endif
+};
+
+struct SameEdge {
+    uint32_t edge;
+
+    uint32_t Get(size_t) const {
+        return edge;
+    }
+
+#ifdef MIN_PLUS_X86
+    __m128i Load2(size_t) const {
+        return _mm_set1_epi32(static_cast<int>(edge));
+    }
+
+    __m128i Load4(size_t) const {
+        return _mm_set1_epi32(static_cast<int>(edge));
+    }
+
+    __attribute__((target("avx2")))
+    __m256i Load8(size_t) const {
+        return _mm256_set1_epi32(static_cast<int>(edge));
+    }
+#endif
+};
+
+template <typename Scalar, typename Edges>
+void RelaxRowScalar(Scalar* weights, uint32_t* edges, Scalar weight_from,
+                    const Scalar* pivot_weights, Edges new_edges, size_t begin, size_t count) {
+    for (size_t i = begin; i < count; ++i) {
+        const Scalar candidate_weight = weight_from + pivot_weights[i];
+        if (candidate_weight < weights[i]) {
+            weights[i] = candidate_weight;
+            edges[i] = new_edges.Get(i);
+        }
+    }
+}
+
+#ifdef MIN_PLUS_X86
+
+// Lanes are only written back when one of them improves: late in the relaxation most
+// rows do not change, and skipping the stores halves the memory traffic.
+
+template <typename Edges>
+void RelaxRowSse2(double* weights, uint32_t* edges, double weight_from,
+                  const double* pivot_weights, Edges new_edges, size_t count) {
+    const __m128d from = _mm_set1_pd(weight_from);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m128d current = _mm_loadu_pd(weights + i);
+        const __m128d candidate = _mm_add_pd(from, _mm_loadu_pd(pivot_weights + i));
+        const __m128d is_less = _mm_cmplt_pd(candidate, current);
+        if (_mm_movemask_pd(is_less) == 0) {
+            continue;
+        }
+        _mm_storeu_pd(weights + i, _mm_or_pd(_mm_and_pd(is_less, candidate), _mm_andnot_pd(is_less, current)));
+
+        // Two 64-bit lane masks narrowed to the two 32-bit edge ids they cover.
+        const __m128i mask = _mm_shuffle_epi32(_mm_castpd_si128(is_less), _MM_SHUFFLE(3, 3, 2, 0));
+        const __m128i old_edges = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(edges + i));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(edges + i),
+                         _mm_or_si128(_mm_and_si128(mask, new_edges.Load2(i)), _mm_andnot_si128(mask, old_edges)));
+    }
+    RelaxRowScalar(weights, edges, weight_from, pivot_weights, new_edges, i, count);
+}
+
+template <typename Edges>
+void RelaxRowSse2(float* weights, uint32_t* edges, float weight_from,
+                  const float* pivot_weights, Edges new_edges, size_t count) {
+    const __m128 from = _mm_set1_ps(weight_from);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 current = _mm_loadu_ps(weights + i);
+        const __m128 candidate = _mm_add_ps(from, _mm_loadu_ps(pivot_weights + i));
+        const __m128 is_less = _mm_cmplt_ps(candidate, current);
+        if (_mm_movemask_ps(is_less) == 0) {
+            continue;
+        }
+        _mm_storeu_ps(weights + i, _mm_or_ps(_mm_and_ps(is_less, candidate), _mm_andnot_ps(is_less, current)));
+
+        const __m128i mask = _mm_castps_si128(is_less);
+        const __m128i old_edges = _mm_loadu_si128(reinterpret_cast<const __m128i*>(edges + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(edges + i),
+                         _mm_or_si128(_mm_and_si128(mask, new_edges.Load4(i)), _mm_andnot_si128(mask, old_edges)));
+    }
+    RelaxRowScalar(weights, edges, weight_from, pivot_weights, new_edges, i, count);
+}
+
+template <typename Edges>
+__attribute__((target("avx2")))
+void RelaxRowAvx2(double* weights, uint32_t* edges, double weight_from,
+                  const double* pivot_weights, Edges new_edges, size_t count) {
+    const __m256d from = _mm256_set1_pd(weight_from);
+    // Picks the low halves of the four 64-bit lane masks.
+    const __m256i narrow = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d current = _mm256_loadu_pd(weights + i);
+        const __m256d candidate = _mm256_add_pd(from, _mm256_loadu_pd(pivot_weights + i));
+        const __m256d is_less = _mm256_cmp_pd(candidate, current, _CMP_LT_OQ);
+        if (_mm256_movemask_pd(is_less) == 0) {
+            continue;
+        }
+        _mm256_storeu_pd(weights + i, _mm256_blendv_pd(current, candidate, is_less));
+
+        const __m128i mask = _mm256_castsi256_si128(
+            _mm256_permutevar8x32_epi32(_mm256_castpd_si256(is_less), narrow));
+        const __m128i old_edges = _mm_loadu_si128(reinterpret_cast<const __m128i*>(edges + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(edges + i),
+                         _mm_blendv_epi8(old_edges, new_edges.Load4(i), mask));
+    }
+    RelaxRowScalar(weights, edges, weight_from, pivot_weights, new_edges, i, count);
+}
+
+template <typename Edges>
+__attribute__((target("avx2")))
+void RelaxRowAvx2(float* weights, uint32_t* edges, float weight_from,
+                  const float* pivot_weights, Edges new_edges, size_t count) {
+    const __m256 from = _mm256_set1_ps(weight_from);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 current = _mm256_loadu_ps(weights + i);
+        const __m256 candidate = _mm256_add_ps(from, _mm256_loadu_ps(pivot_weights + i));
+        const __m256 is_less = _mm256_cmp_ps(candidate, current, _CMP_LT_OQ);
+        if (_mm256_movemask_ps(is_less) == 0) {
+            continue;
+        }
+        _mm256_storeu_ps(weights + i, _mm256_blendv_ps(current, candidate, is_less));
+
+        const __m256i old_edges = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(edges + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(edges + i),
+                            _mm256_blendv_epi8(old_edges, new_edges.Load8(i), _mm256_castps_si256(is_less)));
+    }
+    RelaxRowScalar(weights, edges, weight_from, pivot_weights, new_edges, i, count);
+}
+
+#endif
+
+Kernel DetectKernel() {
+#ifdef MIN_PLUS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return Kernel::AVX2;
+    }
+    return Kernel::SSE2;
+#else
+    return Kernel::SCALAR;
+#endif
+}
+
+template <typename Scalar, typename Edges>
+void Dispatch(Kernel kernel, Scalar* weights, uint32_t* edges, Scalar weight_from,
+              const Scalar* pivot_weights, Edges new_edges, size_t count) {
+    switch (kernel) {
+#ifdef MIN_PLUS_X86
+        case Kernel::AVX2:
+            RelaxRowAvx2(weights, edges, weight_from, pivot_weights, new_edges, count);
+            return;
+        case Kernel::SSE2:
+            RelaxRowSse2(weights, edges, weight_from, pivot_weights, new_edges, count);
+            return;
+#endif
+        default:
+            RelaxRowScalar(weights, edges, weight_from, pivot_weights, new_edges, 0, count);
+    }
+}
+
+Kernel GetBestKernel() {
+    static const Kernel kernel = DetectKernel();
+    return kernel;
+}
+
+}
+
+void RelaxRow(double* weights, uint32_t* prev_edges, double weight_from,
+              const double* pivot_weights, const uint32_t* pivot_prev_edges, size_t count) {
+    Dispatch(GetBestKernel(), weights, prev_edges, weight_from, pivot_weights, PivotEdges{pivot_prev_edges}, count);
+}
+
+void RelaxRow(float* weights, uint32_t* prev_edges, float weight_from,
+              const float* pivot_weights, const uint32_t* pivot_prev_edges, size_t count) {
+    Dispatch(GetBestKernel(), weights, prev_edges, weight_from, pivot_weights, PivotEdges{pivot_prev_edges}, count);
+}
+
+void RelaxRowFirstEdge(double* weights, uint32_t* first_edges, double weight_from, uint32_t first_edge,
+                       const double* pivot_weights, size_t count) {
+    Dispatch(GetBestKernel(), weights, first_edges, weight_from, pivot_weights, SameEdge{first_edge}, count);
+}
+
+void RelaxRowFirstEdge(float* weights, uint32_t* first_edges, float weight_from, uint32_t first_edge,
+                       const float* pivot_weights, size_t count) {
+    Dispatch(GetBestKernel(), weights, first_edges, weight_from, pivot_weights, SameEdge{first_edge}, count);
+}
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace graph::min_plus {
+
+// Row updates of the all-pairs router. Each call runs the widest implementation the CPU
+// supports, AVX2, SSE2 or a scalar loop, chosen once at run time.
+
+// For every i in [0, count) where weight_from + pivot_weights[i] < weights[i], stores the
+// sum to weights[i] and pivot_prev_edges[i] to prev_edges[i]. Every kernel adds and
+// compares exactly like the scalar loop, so all of them give identical rows.
+void RelaxRow(double* weights, uint32_t* prev_edges, double weight_from,
+              const double* pivot_weights, const uint32_t* pivot_prev_edges, size_t count);
+void RelaxRow(float* weights, uint32_t* prev_edges, float weight_from,
+              const float* pivot_weights, const uint32_t* pivot_prev_edges, size_t count);
+
+// The update for tables of first edges: whatever the column, a route improved through
+// the pivot starts with first_edge, the first edge of the route to the pivot.
+void RelaxRowFirstEdge(double* weights, uint32_t* first_edges, double weight_from, uint32_t first_edge,
+                       const double* pivot_weights, size_t count);
+void RelaxRowFirstEdge(float* weights, uint32_t* first_edges, float weight_from, uint32_t first_edge,
+                       const float* pivot_weights, size_t count);
+
+}
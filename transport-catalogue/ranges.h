@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <iterator>
 #include <string_view>
 #include <unordered_map>
@@ -28,6 +29,37 @@ private:
     It end_;
 };
 
+// Iterates over consecutive integers, for ids that are stored contiguously.
+template <typename Integer>
+class CountingIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Integer;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Integer*;
+    using reference = Integer;
+
+    explicit CountingIterator(Integer value)
+        : value_(value) {
+    }
+    Integer operator*() const {
+        return value_;
+    }
+    CountingIterator& operator++() {
+        ++value_;
+        return *this;
+    }
+    bool operator==(const CountingIterator& other) const {
+        return value_ == other.value_;
+    }
+    bool operator!=(const CountingIterator& other) const {
+        return value_ != other.value_;
+    }
+
+private:
+    Integer value_;
+};
+
 template <typename C>
 auto AsRange(const C& container) {
     return Range{container.begin(), container.end()};
@@ -0,0 +1,204 @@
+#include "raptor.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+
+namespace transit {
+
+    namespace {
+        constexpr double UNREACHED = std::numeric_limits<double>::infinity();
+    }
+
+    struct RaptorRouter::SearchState {
+        // labels[k] holds the fastest arrivals with at most k buses.
+        std::vector<std::vector<Label>> labels;
+        std::vector<StopId> marked_stops;
+        std::vector<char> is_marked;
+        std::vector<uint32_t> queued_lines;
+        // First position to scan each queued line from, NO_LINE when not queued.
+        std::vector<uint32_t> line_starts;
+
+        void Reset(size_t stop_count, size_t line_count) {
+            if (labels.empty()){
+                labels.emplace_back();
+            }
+            labels[0].assign(stop_count, Label{UNREACHED, NO_LINE, 0, 0, 0});
+            is_marked.assign(stop_count, 0);
+            line_starts.assign(line_count, NO_LINE);
+            marked_stops.clear();
+            queued_lines.clear();
+        }
+
+        void Mark(StopId stop) {
+            if (!is_marked[stop]){
+                is_marked[stop] = 1;
+                marked_stops.push_back(stop);
+            }
+        }
+    };
+
+    RaptorRouter::RaptorRouter(const transport_directory::TransportCatalogue& db, const RoutingSettings& settings)
+        : wait_time_(static_cast<double>(settings.bus_wait_time)){
+        const double meters_per_min = (1000.0 / 60.0) * static_cast<double>(settings.bus_velocity);
+
+        for (const auto& bus : db.GetAllBuses()){
+            const auto stops = db.GetBusStops(bus);
+            if (stops.empty()){
+                continue;
+            }
+            const auto distances = db.GetBusDistances(bus);
+            lines_.push_back({bus.name, line_stops_.size(), static_cast<uint32_t>(stops.size())});
+            for (size_t i = 0; i < stops.size(); ++i){
+                const auto [stop_id, is_new] = stop_ids_.emplace(stops[i] -> name, static_cast<StopId>(stop_names_.size()));
+                if (is_new){
+                    stop_names_.push_back(stops[i] -> name);
+                }
+                line_stops_.push_back(stop_id -> second);
+                // The last distance of a bus is 0, so its last stop leads nowhere.
+                segment_times_.push_back(distances[i] / meters_per_min);
+            }
+        }
+
+        stop_line_offsets_.assign(stop_names_.size() + 1, 0);
+        for (const StopId stop : line_stops_){
+            ++stop_line_offsets_[stop + 1];
+        }
+        for (size_t stop = 0; stop < stop_names_.size(); ++stop){
+            stop_line_offsets_[stop + 1] += stop_line_offsets_[stop];
+        }
+        stop_lines_.resize(line_stops_.size());
+        std::vector<size_t> fill(stop_line_offsets_.begin(), stop_line_offsets_.end() - 1);
+        for (uint32_t line = 0; line < lines_.size(); ++line){
+            for (uint32_t position = 0; position < lines_[line].size; ++position){
+                const StopId stop = line_stops_[lines_[line].first + position];
+                stop_lines_[fill[stop]++] = {line, position};
+            }
+        }
+    }
+
+    std::optional<RaptorRouter::StopId> RaptorRouter::GetStopId(std::string_view name) const {
+        const auto it = stop_ids_.find(name);
+        if (it == stop_ids_.end()){
+            return {};
+        }
+        return it -> second;
+    }
+
+    RaptorRouter::SearchState& RaptorRouter::GetSearchState() {
+        static thread_local SearchState state;
+        return state;
+    }
+
+    size_t RaptorRouter::Search(SearchState& state, StopId from, std::optional<StopId> bound_target) const {
+        state.Reset(stop_names_.size(), lines_.size());
+        state.labels[0][from].time = 0.0;
+        state.Mark(from);
+
+        size_t round = 0;
+        size_t settled = 0;
+        while (!state.marked_stops.empty()){
+            ++round;
+            if (state.labels.size() <= round){
+                state.labels.emplace_back();
+            }
+            state.labels[round] = state.labels[round - 1];
+
+            for (const StopId stop : state.marked_stops){
+                state.is_marked[stop] = 0;
+                for (size_t i = stop_line_offsets_[stop]; i < stop_line_offsets_[stop + 1]; ++i){
+                    const auto [line, position] = stop_lines_[i];
+                    if (state.line_starts[line] == NO_LINE){
+                        state.queued_lines.push_back(line);
+                        state.line_starts[line] = position;
+                    } else {
+                        state.line_starts[line] = std::min(state.line_starts[line], position);
+                    }
+                }
+            }
+            state.marked_stops.clear();
+
+            const std::vector<Label>& previous = state.labels[round - 1];
+            std::vector<Label>& current = state.labels[round];
+            for (const uint32_t line_id : state.queued_lines){
+                const Line& line = lines_[line_id];
+                bool is_boarded = false;
+                uint32_t board = 0;
+                double departure = 0.0;
+                double ride = 0.0;
+
+                for (uint32_t position = state.line_starts[line_id]; position < line.size; ++position){
+                    const StopId stop = line_stops_[line.first + position];
+                    if (is_boarded){
+                        ride += segment_times_[line.first + position - 1];
+                        const double arrival = departure + ride;
+                        const double bound = bound_target ? current[*bound_target].time : UNREACHED;
+                        if (arrival < current[stop].time && arrival < bound){
+                            current[stop] = {arrival, line_id, board, position, static_cast<uint32_t>(round)};
+                            state.Mark(stop);
+                            ++settled;
+                        }
+                    }
+
+                    // Boarding here instead pays off when the earlier arrival covers the wait.
+                    if (previous[stop].time != UNREACHED
+                        && (!is_boarded || previous[stop].time + wait_time_ < departure + ride)){
+                        is_boarded = true;
+                        board = position;
+                        departure = previous[stop].time + wait_time_;
+                        ride = 0.0;
+                    }
+                }
+                state.line_starts[line_id] = NO_LINE;
+            }
+            state.queued_lines.clear();
+        }
+
+        ++queries_;
+        settled_vertices_ += settled;
+        return round;
+    }
+
+    std::optional<RouteResult> RaptorRouter::ExtractRoute(const SearchState& state, size_t round, StopId to) const {
+        const Label* label = &state.labels[round][to];
+        if (label -> time == UNREACHED){
+            return {};
+        }
+
+        RouteResult result;
+        result.total_time = label -> time;
+        while (label -> line != NO_LINE){
+            const Line& line = lines_[label -> line];
+            double ride = 0.0;
+            for (uint32_t position = label -> board; position < label -> alight; ++position){
+                ride += segment_times_[line.first + position];
+            }
+            const StopId board_stop = line_stops_[line.first + label -> board];
+
+            result.items.push_back({RoutesType::BUS, line.name, ride, static_cast<int>(label -> alight - label -> board)});
+            result.items.push_back({RoutesType::WAIT, stop_names_[board_stop], wait_time_, 0});
+            label = &state.labels[label -> round - 1][board_stop];
+        }
+        std::reverse(result.items.begin(), result.items.end());
+        return result;
+    }
+
+    std::optional<RouteResult> RaptorRouter::BuildRoute(StopId from, StopId to) const {
+        SearchState& state = GetSearchState();
+        const size_t round = Search(state, from, to);
+        return ExtractRoute(state, round, to);
+    }
+
+    std::vector<std::optional<RouteResult>> RaptorRouter::BuildRoutes(StopId from, const std::vector<StopId>& targets) const {
+        SearchState& state = GetSearchState();
+        const size_t round = Search(state, from, std::nullopt);
+
+        std::vector<std::optional<RouteResult>> routes;
+        routes.reserve(targets.size());
+        for (const StopId target : targets){
+            routes.push_back(ExtractRoute(state, round, target));
+        }
+        return routes;
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "router.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+namespace transit {
+
+    // RAPTOR-style router working straight on the buses' stop sequences. Round k finds
+    // the fastest arrivals that take k buses: every bus serving a stop improved in round
+    // k - 1 is scanned once from the first such stop, boarding wherever the arrival of
+    // the previous round plus bus_wait_time beats the bus already taken. A ride from one
+    // stop of a bus to any later one is the same Bus item the routing graph reports, so
+    // routes, total times and items match the graph-based routers.
+    class RaptorRouter {
+    public:
+        using StopId = uint32_t;
+        using SearchStats = graph::BaseRouter<EdgeWeight>::SearchStats;
+
+        RaptorRouter(const transport_directory::TransportCatalogue& db, const RoutingSettings& settings);
+
+        // Only stops served by some bus can be routed from or to.
+        std::optional<StopId> GetStopId(std::string_view name) const;
+
+        std::optional<RouteResult> BuildRoute(StopId from, StopId to) const;
+
+        // Routes from one stop to each of targets, found by a single search.
+        std::vector<std::optional<RouteResult>> BuildRoutes(StopId from, const std::vector<StopId>& targets) const;
+
+        // settled_vertices counts stop labels improved.
+        SearchStats GetSearchStats() const {
+            return {queries_.load(), settled_vertices_.load()};
+        }
+
+    private:
+        static constexpr uint32_t NO_LINE = UINT32_MAX;
+
+        // A bus as a run of line_stops_ and of segment_times_, the time from each stop to
+        // the next one.
+        struct Line {
+            std::string_view name;
+            size_t first;
+            uint32_t size;
+        };
+
+        struct LinePosition {
+            uint32_t line;
+            uint32_t position;
+        };
+
+        // Fastest arrival at a stop with at most a given number of buses, and the ride it
+        // ends with: line from board to alight position, taken in round.
+        struct Label {
+            double time;
+            uint32_t line;
+            uint32_t board;
+            uint32_t alight;
+            uint32_t round;
+        };
+
+        struct SearchState;
+
+        static SearchState& GetSearchState();
+
+        // Runs rounds until no stop improves. With a bound target, rides arriving after the
+        // best time known for it are dropped. Returns the index of the last round.
+        size_t Search(SearchState& state, StopId from, std::optional<StopId> bound_target) const;
+        std::optional<RouteResult> ExtractRoute(const SearchState& state, size_t round, StopId to) const;
+
+        double wait_time_;
+        std::unordered_map<std::string_view, StopId> stop_ids_;
+        std::vector<std::string_view> stop_names_;
+        std::vector<Line> lines_;
+        std::vector<StopId> line_stops_;
+        std::vector<double> segment_times_;
+        // Lines through each stop, indexed by stop_line_offsets_.
+        std::vector<size_t> stop_line_offsets_;
+        std::vector<LinePosition> stop_lines_;
+
+        mutable std::atomic<size_t> queries_{0};
+        mutable std::atomic<size_t> settled_vertices_{0};
+    };
+}
@@ -18,37 +18,34 @@ namespace request_handler {
         return db_.GetStop(name);
     }
 
-    const std::deque<Stop*>& RequestHandler::GetBusStops(std::string_view name) const {
-        return db_.GetBus(name) -> GetStops();
+    BusList RequestHandler::GetStopBuses(std::string_view name) const {
+        return db_.GetStopBuses(*db_.GetStop(name));
     }
 
-    const std::unordered_set<Bus*>& RequestHandler::GetStopBuses(std::string_view name) const {
-        return db_.GetStop(name) -> GetBuses();
-    }
-
-    int RequestHandler::GetRealDistance(const std::deque<Stop*>& stops) const {
-        return RealDistance(db_, stops);
+    const BusStats& RequestHandler::GetBusStats(const Bus& bus) const {
+        return db_.GetBusStats(bus);
     }
 
 
    void RequestHandler::MapRender(std::ostream& out) const {
-        std::deque<Bus*> buses;
+        std::vector<BusRoute> buses;
         for (const auto& bus : db_.GetAllBuses()){
-            if (bus.stops.empty()){
+            const StopList bus_stops = db_.GetBusStops(bus);
+            if (bus_stops.empty()){
                 continue;
             }
-            buses.push_back(const_cast<Bus*>(&bus));
+            buses.push_back({&bus, bus_stops});
         }
-        std::sort(buses.begin(), buses.end(), [](const Bus* lhs, const Bus* rhs){
-            return lhs -> name < rhs -> name;
+        std::sort(buses.begin(), buses.end(), [](const BusRoute& lhs, const BusRoute& rhs){
+            return lhs.bus -> name < rhs.bus -> name;
         });
 
-        std::deque<Stop*> stops;
+        std::vector<const Stop*> stops;
         for (const auto& stop : db_.GetAllStops()){
-            if (stop.buses.empty()){
+            if (db_.GetStopBuses(stop).empty()){
                 continue;
             }
-            stops.push_back(const_cast<Stop*>(&stop));
+            stops.push_back(&stop);
         }
 
         std::sort(stops.begin(), stops.end(), [](const auto& lhs, const auto& rhs){
@@ -58,16 +55,167 @@ namespace request_handler {
         render_.RenderMap(out, buses, stops);
    }
 
-   std::optional<graph::Router<EdgeWeight>::RouteInfo> RequestHandler::GetRoute(
+   std::optional<RouteResult> RequestHandler::GetRoute(
     std::string_view from, std::string_view to
     ) const {
-        if (!helper_.GetVertexId(from)
-            || !helper_.GetVertexId(to)){
+        EnsureRouters();
+        if (raptor_){
+            const auto from_id = raptor_ -> GetStopId(from);
+            const auto to_id = raptor_ -> GetStopId(to);
+            if (!from_id || !to_id){
+                return {};
+            }
+
+            const std::pair<graph::VertexId, graph::VertexId> key{*from_id, *to_id};
+            if (auto cached = route_cache_.Get(key)){
+                return std::move(*cached);
+            }
+            auto route = raptor_ -> BuildRoute(*from_id, *to_id);
+            route_cache_.Put(key, route);
+            return route;
+        }
+
+        const auto from_id = helper_.GetVertexId(from);
+        const auto to_id = helper_.GetVertexId(to);
+        if (!from_id || !to_id){
+            return {};
+        }
+
+        if (!helper_.MayReach(*from_id, *to_id)){
+            return {};
+        }
+
+        const std::pair key{*from_id, *to_id};
+        if (auto cached = route_cache_.Get(key)){
+            return std::move(*cached);
+        }
+        // Requests run on several threads; each keeps one edge buffer for all its routes.
+        thread_local std::vector<graph::EdgeId> edges;
+        std::optional<RouteResult> route;
+        if (const auto weight = router_ -> WriteRoute(*from_id, *to_id, edges)){
+            route = helper_.MakeRoute(*weight, edges);
+        }
+        route_cache_.Put(key, route);
+        return route;
+    }
+
+    std::vector<std::vector<std::optional<RouteResult>>> RequestHandler::GetRouteMatrix(
+        const std::vector<std::string_view>& from,
+        const std::vector<std::string_view>& to,
+        bool with_items
+    ) const {
+        EnsureRouters();
+        const auto get_id = [this](std::string_view name) -> std::optional<graph::VertexId> {
+            if (raptor_){
+                return raptor_ -> GetStopId(name);
+            }
+            return helper_.GetVertexId(name);
+        };
+
+        std::vector<graph::VertexId> targets;
+        std::vector<size_t> target_columns;
+        for (size_t column = 0; column < to.size(); ++column){
+            if (const auto id = get_id(to[column])){
+                targets.push_back(*id);
+                target_columns.push_back(column);
+            }
+        }
+        std::vector<transit::RaptorRouter::StopId> stop_targets;
+        if (raptor_){
+            stop_targets.assign(targets.begin(), targets.end());
+        }
+
+        std::vector<graph::VertexId> reachable_targets;
+        std::vector<size_t> reachable_columns;
+
+        std::vector<std::vector<std::optional<RouteResult>>> matrix;
+        matrix.reserve(from.size());
+        for (const auto name : from){
+            auto& row = matrix.emplace_back(to.size());
+            const auto source = get_id(name);
+            if (!source || targets.empty()){
+                continue;
+            }
+            if (raptor_){
+                auto routes = raptor_ -> BuildRoutes(static_cast<transit::RaptorRouter::StopId>(*source), stop_targets);
+                for (size_t i = 0; i < routes.size(); ++i){
+                    row[target_columns[i]] = std::move(routes[i]);
+                }
+                continue;
+            }
+            if (!with_items && HasDirectWeights()){
+                for (size_t i = 0; i < targets.size(); ++i){
+                    if (const auto weight = router_ -> ComputeWeight(*source, targets[i])){
+                        row[target_columns[i]] = RouteResult{*weight, {}};
+                    }
+                }
+                continue;
+            }
+            // A target the source cannot reach would keep the search going over the
+            // source's whole component.
+            reachable_targets.clear();
+            reachable_columns.clear();
+            for (size_t i = 0; i < targets.size(); ++i){
+                if (helper_.MayReach(*source, targets[i])){
+                    reachable_targets.push_back(targets[i]);
+                    reachable_columns.push_back(target_columns[i]);
+                }
+            }
+            if (reachable_targets.empty()){
+                continue;
+            }
+            const auto routes = matrix_router_ -> BuildRoutes(*source, reachable_targets);
+            for (size_t i = 0; i < routes.size(); ++i){
+                if (routes[i]){
+                    row[reachable_columns[i]] = helper_.MakeRoute(*routes[i]);
+                }
+            }
+        }
+        return matrix;
+    }
+
+    bool RequestHandler::HasDirectWeights() const {
+        const RouterType type = helper_.GetSettings().router_type;
+        return type == RouterType::ALL_PAIRS || type == RouterType::HUB_LABELS;
+    }
+
+    void RequestHandler::EnsureRouters() const {
+        std::call_once(routers_once_, [this](){
+            Routers routers = make_routers_();
+            router_ = std::move(routers.router);
+            raptor_ = std::move(routers.raptor);
+            if (!raptor_){
+                matrix_router_.emplace(helper_.GetGraph());
+            }
+            has_routers_ = true;
+        });
+    }
+
+    void RequestHandler::PrepareRouters() const {
+        EnsureRouters();
+    }
+
+    std::unique_ptr<transit::RaptorRouter> RequestHandler::MakeRaptorRouter(
+        const TransportCatalogue& db, const RoutingSettings& settings
+    ){
+        if (settings.router_type != RouterType::RAPTOR){
+            return nullptr;
+        }
+        return std::make_unique<transit::RaptorRouter>(db, settings);
+    }
+
+    cache::CacheStats RequestHandler::GetRouteCacheStats() const {
+        return route_cache_.GetStats();
+    }
+
+    graph::BaseRouter<EdgeWeight>::SearchStats RequestHandler::GetRouterStats() const {
+        if (!has_routers_){
             return {};
         }
-        return router_.BuildRoute(
-            helper_.GetVertexId(from).value(), helper_.GetVertexId(to).value()
-        );
+        if (raptor_){
+            return raptor_ -> GetSearchStats();
+        }
+        return router_ -> GetSearchStats();
     }
 
     const RouterHelper& RequestHandler::GetHelper() const {
@@ -1,47 +1,119 @@
 #pragma once
 
+#include "lru_cache.h"
 #include "transport_catalogue.h"
 #include "map_renderer.h"
+#include "raptor.h"
 #include "router.h"
 #include "transport_router.h"
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
 
 namespace request_handler {
 
     using namespace transport_directory;
 
+    struct HashPairOfVertices{
+        size_t operator()(
+            const std::pair<graph::VertexId, graph::VertexId>& vertices) const {
+            return hasher(vertices.first) * 37 + hasher(vertices.second);
+        }
+
+        std::hash<graph::VertexId> hasher;
+    };
+
+    // What answers route requests: a graph router, or RAPTOR with no router at all.
+    struct Routers {
+        std::unique_ptr<graph::BaseRouter<EdgeWeight>> router;
+        std::unique_ptr<transit::RaptorRouter> raptor;
+    };
+
+    using RoutersFactory = std::function<Routers()>;
+
     class RequestHandler final {
     private:
+        // Keyed by graph vertices, or by RAPTOR stop ids when there is no graph.
+        using RouteCache = cache::LruCache<
+            std::pair<graph::VertexId, graph::VertexId>,
+            std::optional<RouteResult>, HashPairOfVertices>;
+
         const transport_directory::TransportCatalogue& db_;
         const map_render::RenderSVG& render_;
         const RouterHelper& helper_;
-        const graph::Router<EdgeWeight> router_;
+        const RoutersFactory make_routers_;
+        // Built by make_routers_ on the first request that routes.
+        mutable std::once_flag routers_once_;
+        mutable std::atomic<bool> has_routers_{false};
+        mutable std::unique_ptr<graph::BaseRouter<EdgeWeight>> router_;
+        mutable std::unique_ptr<transit::RaptorRouter> raptor_;
+        mutable std::optional<graph::DijkstraRouter<EdgeWeight>> matrix_router_;
+        mutable RouteCache route_cache_;
+
+        void EnsureRouters() const;
+
+        // Whether router_ answers a route weight with a lookup rather than a search.
+        bool HasDirectWeights() const;
     public:
+        // Routers of a helper whose graph is already loaded.
         explicit RequestHandler(
             const TransportCatalogue& db, const map_render::RenderSVG& render,
             const RouterHelper& helper
+        )
+            : RequestHandler(db, render, helper, [&db, &helper](){
+                return Routers{helper.BuildRouter(), MakeRaptorRouter(db, helper.GetSettings())};
+            }){}
+
+        // make_routers runs once, when a request first needs a route, and may load the
+        // helper's graph before that: routing costs nothing to batches that never route.
+        RequestHandler(
+            const TransportCatalogue& db, const map_render::RenderSVG& render,
+            const RouterHelper& helper, RoutersFactory make_routers
         )
             : db_(db)
             , render_(render)
             , helper_(helper)
-            , router_(helper.GetGraph()){}
+            , make_routers_(std::move(make_routers))
+            , route_cache_(helper.GetSettings().route_cache_size){}
+
+        // Null unless settings ask for RouterType::RAPTOR.
+        static std::unique_ptr<transit::RaptorRouter> MakeRaptorRouter(
+            const TransportCatalogue& db, const RoutingSettings& settings);
+
+        // Builds the routers now instead of on the first route request.
+        void PrepareRouters() const;
 
         const Stop* GetStopByName(std::string_view name) const;
 
         const Bus* GetBusByName(std::string_view name) const;
 
-        const std::deque<Stop*>& GetBusStops(std::string_view name) const;
+        BusList GetStopBuses(std::string_view name) const;
 
-        const std::unordered_set<Bus*>& GetStopBuses(std::string_view name) const;
-
-        int GetRealDistance(const std::deque<Stop*>& stops) const;
+        const BusStats& GetBusStats(const Bus& bus) const;
 
         void MapRender(std::ostream& out) const;
 
-        std::optional<graph::Router<EdgeWeight>::RouteInfo> GetRoute(
+        std::optional<RouteResult> GetRoute(
             std::string_view from, std::string_view to
         ) const;
 
+        // Row i holds the routes from from[i] to every stop of to; unknown stops get no routes.
+        // Without items, routers that know route weights directly leave the items empty.
+        std::vector<std::vector<std::optional<RouteResult>>> GetRouteMatrix(
+            const std::vector<std::string_view>& from,
+            const std::vector<std::string_view>& to,
+            bool with_items = true
+        ) const;
+
+        cache::CacheStats GetRouteCacheStats() const;
+
+        graph::BaseRouter<EdgeWeight>::SearchStats GetRouterStats() const;
+
         const RouterHelper& GetHelper() const;
     };
 }
@@ -1,13 +1,18 @@
 #pragma once
 
 #include "graph.h"
+#include "min_plus.h"
+#include "thread_pool.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -15,103 +20,564 @@
 namespace graph {
 
 template <typename Weight>
-class Router {
-private:
-    using Graph = DirectedWeightedGraph<Weight>;
-
+class BaseRouter {
 public:
-    explicit Router(const Graph& graph);
-
     struct RouteInfo {
         Weight weight;
         std::vector<EdgeId> edges;
     };
 
-    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+    // Work done by searching routers: queries answered and vertices taken off the queue.
+    struct SearchStats {
+        size_t queries = 0;
+        size_t settled_vertices = 0;
+    };
 
-private:
-    struct RouteInternalData {
-        Weight weight;
-        std::optional<EdgeId> prev_edge;
+    // Entries a router precomputed per vertex, such as hub labels, and their size.
+    struct IndexStats {
+        size_t entries = 0;
+        size_t max_vertex_entries = 0;
+        size_t bytes = 0;
     };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+
+    virtual ~BaseRouter() = default;
+
+    virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+
+    // Overwrites edges with the route and returns its weight, so that a caller answering
+    // many queries reuses one buffer. Routers that walk their own tables override it.
+    virtual std::optional<Weight> WriteRoute(VertexId from, VertexId to, std::vector<EdgeId>& edges) const {
+        auto route = BuildRoute(from, to);
+        if (!route) {
+            return std::nullopt;
+        }
+        edges.assign(route -> edges.begin(), route -> edges.end());
+        return route -> weight;
+    }
+
+    // Weight of the route alone, for routers that know it without rebuilding the route.
+    virtual std::optional<Weight> ComputeWeight(VertexId from, VertexId to) const {
+        if (auto route = BuildRoute(from, to)) {
+            return route -> weight;
+        }
+        return std::nullopt;
+    }
+
+    virtual SearchStats GetSearchStats() const {
+        return {};
+    }
+
+    // Empty for routers without a per-vertex index.
+    virtual IndexStats GetIndexStats() const {
+        return {};
+    }
+};
+
+// The scalar an all-pairs table keeps for a Weight: whatever orders and adds weights.
+// Weights that also carry per-edge metadata specialize this to drop it from the table.
+template <typename Weight>
+struct WeightTraits {
+    using Scalar = Weight;
+
+    static Scalar ToScalar(const Weight& weight) {
+        return weight;
+    }
+
+    static Weight FromScalar(Scalar scalar) {
+        return scalar;
+    }
+};
+
+// Which edge of each route an all-pairs table keeps. Last edges are rebuilt from the end
+// of the route and reversed; first edges are successors, followed from the start of the
+// route straight into the caller's buffer.
+enum class RouteEdges {
+    LAST,
+    FIRST
+};
+
+// All-pairs router: Floyd-Warshall over two flat row-major V x V arrays, one of route
+// weights as Scalar (pass float to halve it) and one of 32-bit last or first edges,
+// UNREACHABLE marking pairs with no route. Everything else about an edge is read from
+// the graph when a path is rebuilt.
+//
+// Relaxation runs in blocks of BLOCK_SIZE pivot vertices. A block first snapshots each
+// pivot row as it was right before its own step, then every band of rows is relaxed
+// through the whole block tile by tile on a thread pool. Each cell sees the same
+// candidates in the same order as in the textbook triple loop, so the table is
+// identical to the sequential one.
+template <typename Weight, typename Scalar = typename WeightTraits<Weight>::Scalar>
+class Router final : public BaseRouter<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using Traits = WeightTraits<Weight>;
+
+    static_assert(std::numeric_limits<Scalar>::has_infinity,
+                  "Unreachable pairs are kept as an infinite weight");
+
+public:
+    using RouteInfo = typename BaseRouter<Weight>::RouteInfo;
+
+    using RouteEdge = uint32_t;
+
+    static constexpr RouteEdge UNREACHABLE = std::numeric_limits<RouteEdge>::max();
+    // Edge of the empty route from a vertex to itself.
+    static constexpr RouteEdge NO_EDGE = UNREACHABLE - 1;
+
+    explicit Router(const Graph& graph, RouteEdges route_edge_kind = RouteEdges::LAST,
+                    size_t thread_count = parallel::DefaultThreadCount());
+
+    // Adopts V x V tables that an earlier Router built over the same graph, for example
+    // ones mapped from disk. The memory must outlive the router.
+    Router(const Graph& graph, const Scalar* weights, const RouteEdge* route_edges,
+           RouteEdges route_edge_kind = RouteEdges::LAST);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    std::optional<Weight> WriteRoute(VertexId from, VertexId to, std::vector<EdgeId>& edges) const override;
+
+    std::optional<Weight> ComputeWeight(VertexId from, VertexId to) const override;
+
+    const Scalar* GetWeightTable() const {
+        return weights_data_;
+    }
+
+    const RouteEdge* GetRouteEdgeTable() const {
+        return route_edges_data_;
+    }
+
+    RouteEdges GetRouteEdgeKind() const {
+        return route_edge_kind_;
+    }
+
+private:
+
+    static constexpr Scalar INFINITE_WEIGHT = std::numeric_limits<Scalar>::infinity();
+
+    static constexpr size_t BLOCK_SIZE = 64;
+    static constexpr size_t BAND_SIZE = 16;
+    static constexpr size_t TILE_BYTES = 1 << 17;
+    static constexpr size_t COLUMN_TILE = TILE_BYTES / (BLOCK_SIZE * (sizeof(Scalar) + sizeof(RouteEdge)));
+
+    size_t GetIndex(VertexId from, VertexId to) const {
+        return from * vertex_count_ + to;
+    }
 
     void InitializeRoutesInternalData(const Graph& graph) {
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+        if (graph.GetEdgeCount() >= NO_EDGE) {
+            throw std::length_error("Too many edges for 32-bit edge ids");
+        }
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            weights_[GetIndex(vertex, vertex)] = Traits::ToScalar(ZERO_WEIGHT);
+            route_edges_[GetIndex(vertex, vertex)] = NO_EDGE;
             for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
                 const auto& edge = graph.GetEdge(edge_id);
                 if (edge.weight < ZERO_WEIGHT) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                const size_t index = GetIndex(vertex, edge.to);
+                const Scalar weight = Traits::ToScalar(edge.weight);
+                if (route_edges_[index] == UNREACHABLE || weights_[index] > weight) {
+                    weights_[index] = weight;
+                    route_edges_[index] = static_cast<RouteEdge>(edge_id);
+                }
+            }
+        }
+    }
+
+    // Relaxes columns [column_begin, column_end) of one row through a single pivot whose
+    // distance from the row's vertex is weight_from and whose route from it starts with
+    // edge_from. An improved route ends like the pivot's route to the column and starts
+    // with edge_from; improving a cell through its own column is impossible, so both
+    // edges are read before the row changes. Floating-point tables go through the vector
+    // kernels of min_plus.
+    void RelaxRowThroughVertex(Scalar* weights, RouteEdge* route_edges, Scalar weight_from, RouteEdge edge_from,
+                               const Scalar* pivot_weights, const RouteEdge* pivot_route_edges,
+                               size_t column_begin, size_t column_end) const {
+        const bool keeps_first = route_edge_kind_ == RouteEdges::FIRST;
+        if constexpr (std::is_same_v<Scalar, double> || std::is_same_v<Scalar, float>) {
+            if (keeps_first) {
+                min_plus::RelaxRowFirstEdge(weights + column_begin, route_edges + column_begin, weight_from,
+                                            edge_from, pivot_weights + column_begin, column_end - column_begin);
+            } else {
+                min_plus::RelaxRow(weights + column_begin, route_edges + column_begin, weight_from,
+                                   pivot_weights + column_begin, pivot_route_edges + column_begin,
+                                   column_end - column_begin);
+            }
+        } else {
+            for (size_t vertex_to = column_begin; vertex_to < column_end; ++vertex_to) {
+                const Scalar candidate_weight = weight_from + pivot_weights[vertex_to];
+                if (candidate_weight < weights[vertex_to]) {
+                    weights[vertex_to] = candidate_weight;
+                    route_edges[vertex_to] = keeps_first ? edge_from : pivot_route_edges[vertex_to];
                 }
             }
         }
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-                    const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-        const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-            route_relaxing = {candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+    void SnapshotPivotRows(VertexId block_begin, VertexId block_end);
+    void RelaxBandThroughBlock(VertexId band_begin, VertexId band_end,
+                               VertexId block_begin, VertexId block_end);
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    size_t vertex_count_;
+    RouteEdges route_edge_kind_;
+    std::vector<Scalar> weights_;
+    std::vector<RouteEdge> route_edges_;
+    const Scalar* weights_data_;
+    const RouteEdge* route_edges_data_;
+    // Rows of the current block's pivots, each taken right before its own relaxation step.
+    std::vector<Scalar> pivot_weights_;
+    std::vector<RouteEdge> pivot_route_edges_;
+};
+
+template <typename Weight, typename Scalar>
+Router<Weight, Scalar>::Router(const Graph& graph, RouteEdges route_edge_kind, size_t thread_count)
+    : graph_(graph)
+    , vertex_count_(graph.GetVertexCount())
+    , route_edge_kind_(route_edge_kind)
+    , weights_(vertex_count_ * vertex_count_, INFINITE_WEIGHT)
+    , route_edges_(vertex_count_ * vertex_count_, UNREACHABLE)
+    , weights_data_(weights_.data())
+    , route_edges_data_(route_edges_.data())
+{
+    InitializeRoutesInternalData(graph);
+
+    parallel::ThreadPool pool(thread_count);
+    const size_t band_count = (vertex_count_ + BAND_SIZE - 1) / BAND_SIZE;
+    for (VertexId block_begin = 0; block_begin < vertex_count_; block_begin += BLOCK_SIZE) {
+        const VertexId block_end = std::min(block_begin + BLOCK_SIZE, vertex_count_);
+        SnapshotPivotRows(block_begin, block_end);
+        pool.ParallelFor(band_count, [this, block_begin, block_end](size_t band) {
+            const VertexId band_begin = band * BAND_SIZE;
+            RelaxBandThroughBlock(band_begin, std::min(band_begin + BAND_SIZE, vertex_count_),
+                                  block_begin, block_end);
+        });
+    }
+    pivot_weights_ = {};
+    pivot_route_edges_ = {};
+}
+
+template <typename Weight, typename Scalar>
+Router<Weight, Scalar>::Router(const Graph& graph, const Scalar* weights, const RouteEdge* route_edges,
+                               RouteEdges route_edge_kind)
+    : graph_(graph)
+    , vertex_count_(graph.GetVertexCount())
+    , route_edge_kind_(route_edge_kind)
+    , weights_data_(weights)
+    , route_edges_data_(route_edges)
+{
+}
+
+template <typename Weight, typename Scalar>
+void Router<Weight, Scalar>::SnapshotPivotRows(VertexId block_begin, VertexId block_end) {
+    pivot_weights_.assign(weights_.begin() + GetIndex(block_begin, 0),
+                          weights_.begin() + GetIndex(block_end, 0));
+    pivot_route_edges_.assign(route_edges_.begin() + GetIndex(block_begin, 0),
+                             route_edges_.begin() + GetIndex(block_end, 0));
+    for (VertexId pivot = block_begin; pivot < block_end; ++pivot) {
+        const size_t row = (pivot - block_begin) * vertex_count_;
+        for (VertexId vertex_through = block_begin; vertex_through < pivot; ++vertex_through) {
+            const size_t through_row = (vertex_through - block_begin) * vertex_count_;
+            RelaxRowThroughVertex(&pivot_weights_[row], &pivot_route_edges_[row],
+                                  pivot_weights_[row + vertex_through], pivot_route_edges_[row + vertex_through],
+                                  &pivot_weights_[through_row], &pivot_route_edges_[through_row],
+                                  0, vertex_count_);
+        }
+    }
+}
+
+template <typename Weight, typename Scalar>
+void Router<Weight, Scalar>::RelaxBandThroughBlock(VertexId band_begin, VertexId band_end,
+                                                   VertexId block_begin, VertexId block_end) {
+    const size_t block_size = block_end - block_begin;
+
+    // The pivot columns go first: at step k a row needs its k-th weight and edge as of
+    // step k - 1, so those are recorded while the row walks through the block.
+    std::vector<Scalar> weights_from((band_end - band_begin) * block_size);
+    std::vector<RouteEdge> edges_from((band_end - band_begin) * block_size);
+    for (VertexId vertex_from = band_begin; vertex_from < band_end; ++vertex_from) {
+        Scalar* row_weights = &weights_[GetIndex(vertex_from, 0)];
+        RouteEdge* row_route_edges = &route_edges_[GetIndex(vertex_from, 0)];
+        Scalar* row_weights_from = &weights_from[(vertex_from - band_begin) * block_size];
+        RouteEdge* row_edges_from = &edges_from[(vertex_from - band_begin) * block_size];
+        for (VertexId vertex_through = block_begin; vertex_through < block_end; ++vertex_through) {
+            const size_t pivot_row = (vertex_through - block_begin) * vertex_count_;
+            const Scalar weight_from = row_weights_from[vertex_through - block_begin] = row_weights[vertex_through];
+            const RouteEdge edge_from = row_edges_from[vertex_through - block_begin] = row_route_edges[vertex_through];
+            RelaxRowThroughVertex(row_weights, row_route_edges, weight_from, edge_from,
+                                  &pivot_weights_[pivot_row], &pivot_route_edges_[pivot_row],
+                                  block_begin, block_end);
         }
     }
 
-    void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
+    const auto relax_columns = [&](size_t column_begin, size_t column_end) {
+        for (size_t tile_begin = column_begin; tile_begin < column_end; tile_begin += COLUMN_TILE) {
+            const size_t tile_end = std::min(tile_begin + COLUMN_TILE, column_end);
+            for (VertexId vertex_from = band_begin; vertex_from < band_end; ++vertex_from) {
+                Scalar* row_weights = &weights_[GetIndex(vertex_from, 0)];
+                RouteEdge* row_route_edges = &route_edges_[GetIndex(vertex_from, 0)];
+                const Scalar* row_weights_from = &weights_from[(vertex_from - band_begin) * block_size];
+                const RouteEdge* row_edges_from = &edges_from[(vertex_from - band_begin) * block_size];
+                for (size_t through = 0; through < block_size; ++through) {
+                    if (row_weights_from[through] == INFINITE_WEIGHT) {
+                        continue;
                     }
+                    const size_t pivot_row = through * vertex_count_;
+                    RelaxRowThroughVertex(row_weights, row_route_edges, row_weights_from[through], row_edges_from[through],
+                                          &pivot_weights_[pivot_row], &pivot_route_edges_[pivot_row],
+                                          tile_begin, tile_end);
                 }
             }
         }
+    };
+    relax_columns(0, block_begin);
+    relax_columns(block_end, vertex_count_);
+}
+
+template <typename Weight, typename Scalar>
+std::optional<typename Router<Weight, Scalar>::RouteInfo> Router<Weight, Scalar>::BuildRoute(
+    VertexId from, VertexId to) const {
+    std::vector<EdgeId> edges;
+    if (auto weight = WriteRoute(from, to, edges)) {
+        return RouteInfo{*weight, std::move(edges)};
     }
+    return std::nullopt;
+}
+
+template <typename Weight, typename Scalar>
+std::optional<Weight> Router<Weight, Scalar>::WriteRoute(VertexId from, VertexId to, std::vector<EdgeId>& edges) const {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    if (route_edges_data_[GetIndex(from, to)] == UNREACHABLE) {
+        return std::nullopt;
+    }
+    // Tables built here give a simple path of real edges, but adopted ones may come from
+    // a damaged file: a marker on the way or a walk longer than a simple path ends it.
+    const size_t edge_count = graph_.GetEdgeCount();
+    const auto append = [this, &edges, edge_count](RouteEdge edge) {
+        if (edge >= edge_count || edges.size() >= vertex_count_) {
+            throw std::runtime_error("Route tables are inconsistent with the graph");
+        }
+        edges.push_back(edge);
+    };
+    edges.clear();
+    if (route_edge_kind_ == RouteEdges::FIRST) {
+        const RouteEdge* column = route_edges_data_ + to;
+        for (VertexId vertex = from; vertex != to; vertex = graph_.GetEdge(edges.back()).to) {
+            append(column[vertex * vertex_count_]);
+        }
+    } else {
+        const RouteEdge* row = route_edges_data_ + GetIndex(from, 0);
+        for (VertexId vertex = to; vertex != from; vertex = graph_.GetEdge(edges.back()).from) {
+            append(row[vertex]);
+        }
+        std::reverse(edges.begin(), edges.end());
+    }
+    return Traits::FromScalar(weights_data_[GetIndex(from, to)]);
+}
+
+template <typename Weight, typename Scalar>
+std::optional<Weight> Router<Weight, Scalar>::ComputeWeight(VertexId from, VertexId to) const {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    if (route_edges_data_[GetIndex(from, to)] == UNREACHABLE) {
+        return std::nullopt;
+    }
+    return Traits::FromScalar(weights_data_[GetIndex(from, to)]);
+}
+
+// Point-to-point Dijkstra on every BuildRoute call: no precomputation and O(V) memory
+// instead of the V x V table of Router. Scratch buffers live per thread and are reset
+// lazily through a generation stamp, so a query touches only the vertices it reaches.
+// BuildRoutes answers one-to-many queries with a single search that stops once the
+// last target is settled.
+template <typename Weight>
+class DijkstraRouter final : public BaseRouter<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename BaseRouter<Weight>::RouteInfo;
+    using SearchStats = typename BaseRouter<Weight>::SearchStats;
+
+    explicit DijkstraRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    SearchStats GetSearchStats() const override {
+        return {queries_.load(), settled_vertices_.load()};
+    }
+
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from,
+                                                      const std::vector<VertexId>& targets) const;
+
+private:
+    struct HeapItem {
+        Weight weight;
+        VertexId vertex;
+
+        bool operator<(const HeapItem& other) const {
+            return weight > other.weight;
+        }
+    };
+
+    struct SearchState {
+        std::vector<Weight> weights;
+        std::vector<std::optional<EdgeId>> prev_edges;
+        std::vector<uint64_t> stamps;
+        std::vector<uint64_t> target_stamps;
+        std::vector<HeapItem> heap;
+        uint64_t generation = 0;
+
+        void Reset(size_t vertex_count) {
+            if (stamps.size() < vertex_count) {
+                weights.resize(vertex_count);
+                prev_edges.resize(vertex_count);
+                stamps.resize(vertex_count, 0);
+                target_stamps.resize(vertex_count, 0);
+            }
+            heap.clear();
+            ++generation;
+        }
+
+        bool IsReached(VertexId vertex) const {
+            return stamps[vertex] == generation;
+        }
+    };
+
+    static SearchState& GetSearchState() {
+        static thread_local SearchState state;
+        return state;
+    }
+
+    void CheckVertex(VertexId vertex) const {
+        if (vertex >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+    }
+
+    const SearchState& Search(VertexId from, const VertexId* targets_begin,
+                              const VertexId* targets_end) const;
+    std::optional<RouteInfo> ExtractRoute(const SearchState& state, VertexId to) const;
 
     static constexpr Weight ZERO_WEIGHT{};
     const Graph& graph_;
-    RoutesInternalData routes_internal_data_;
+
+    mutable std::atomic<size_t> queries_{0};
+    mutable std::atomic<size_t> settled_vertices_{0};
 };
 
 template <typename Weight>
-Router<Weight>::Router(const Graph& graph)
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph)
     : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
 {
-    InitializeRoutesInternalData(graph);
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+const typename DijkstraRouter<Weight>::SearchState& DijkstraRouter<Weight>::Search(
+    VertexId from, const VertexId* targets_begin, const VertexId* targets_end) const {
+    SearchState& state = GetSearchState();
+    state.Reset(graph_.GetVertexCount());
+
+    size_t targets_left = 0;
+    for (const VertexId* target = targets_begin; target != targets_end; ++target) {
+        if (state.target_stamps[*target] != state.generation) {
+            state.target_stamps[*target] = state.generation;
+            ++targets_left;
+        }
+    }
+
+    state.stamps[from] = state.generation;
+    state.weights[from] = ZERO_WEIGHT;
+    state.prev_edges[from] = std::nullopt;
+    state.heap.push_back({ZERO_WEIGHT, from});
+    size_t settled = 0;
+
+    while (!state.heap.empty() && targets_left != 0) {
+        std::pop_heap(state.heap.begin(), state.heap.end());
+        const HeapItem item = state.heap.back();
+        state.heap.pop_back();
+
+        if (state.weights[item.vertex] < item.weight) {
+            continue;
+        }
+        ++settled;
+        if (state.target_stamps[item.vertex] == state.generation) {
+            state.target_stamps[item.vertex] = 0;
+            if (--targets_left == 0) {
+                break;
+            }
+        }
 
-    const size_t vertex_count = graph.GetVertexCount();
-    for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-        RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(item.vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Weight candidate_weight = item.weight + edge.weight;
+            if (!state.IsReached(edge.to) || candidate_weight < state.weights[edge.to]) {
+                state.stamps[edge.to] = state.generation;
+                state.weights[edge.to] = candidate_weight;
+                state.prev_edges[edge.to] = edge_id;
+                state.heap.push_back({candidate_weight, edge.to});
+                std::push_heap(state.heap.begin(), state.heap.end());
+            }
+        }
     }
+
+    ++queries_;
+    settled_vertices_ += settled;
+    return state;
 }
 
 template <typename Weight>
-std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
-                                                                             VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-    if (!route_internal_data) {
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::ExtractRoute(
+    const SearchState& state, VertexId to) const {
+    if (!state.IsReached(to)) {
         return std::nullopt;
     }
-    const Weight weight = route_internal_data->weight;
+
     std::vector<EdgeId> edges;
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
+    for (std::optional<EdgeId> edge_id = state.prev_edges[to];
          edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+         edge_id = state.prev_edges[graph_.GetEdge(*edge_id).from])
     {
         edges.push_back(*edge_id);
     }
     std::reverse(edges.begin(), edges.end());
 
-    return RouteInfo{weight, std::move(edges)};
+    return RouteInfo{state.weights[to], std::move(edges)};
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(
+    VertexId from, VertexId to) const {
+    CheckVertex(from);
+    CheckVertex(to);
+    return ExtractRoute(Search(from, &to, &to + 1), to);
+}
+
+template <typename Weight>
+std::vector<std::optional<typename DijkstraRouter<Weight>::RouteInfo>>
+DijkstraRouter<Weight>::BuildRoutes(VertexId from, const std::vector<VertexId>& targets) const {
+    CheckVertex(from);
+    for (const VertexId target : targets) {
+        CheckVertex(target);
+    }
+
+    const SearchState& state = Search(from, targets.data(), targets.data() + targets.size());
+    std::vector<std::optional<RouteInfo>> routes;
+    routes.reserve(targets.size());
+    for (const VertexId target : targets) {
+        routes.push_back(ExtractRoute(state, target));
+    }
+    return routes;
 }
 
 }
\ No newline at end of file
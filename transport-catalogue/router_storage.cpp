@@ -0,0 +1,369 @@
+#include "router_storage.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace router_storage {
+
+    using namespace std::literals;
+    using RouteEdge = graph::Router<EdgeWeight>::RouteEdge;
+    using AllPairsRouter = graph::Router<EdgeWeight>;
+
+    struct PrecomputedRouter::Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t weight_size;
+        uint64_t input_hash;
+        uint64_t vertex_count;
+        uint64_t edge_count;
+        uint64_t stop_count;
+        uint64_t names_size;
+        uint64_t checksum;
+    };
+
+    struct PrecomputedRouter::Edge {
+        uint64_t from;
+        uint64_t to;
+        double time;
+        uint32_t name_offset;
+        uint32_t name_size;
+        int32_t span_counter;
+        uint32_t action;
+    };
+
+    struct PrecomputedRouter::Stop {
+        uint32_t name_offset;
+        uint32_t name_size;
+        uint64_t vertex;
+    };
+
+    namespace {
+        constexpr char MAGIC[8] = {'T', 'C', 'R', 'O', 'U', 'T', 'E', '\0'};
+
+        size_t AlignUp(size_t size) {
+            return (size + 7) & ~size_t{7};
+        }
+
+        class NamesWriter {
+        public:
+            std::pair<uint32_t, uint32_t> Add(std::string_view name) {
+                const auto it = offsets_.find(name);
+                if (it != offsets_.end()){
+                    return {it -> second, static_cast<uint32_t>(name.size())};
+                }
+                const auto offset = static_cast<uint32_t>(names_.size());
+                names_.append(name);
+                offsets_.emplace(name, offset);
+                return {offset, static_cast<uint32_t>(name.size())};
+            }
+
+            const std::string& GetNames() const {
+                return names_;
+            }
+
+        private:
+            std::string names_;
+            std::unordered_map<std::string_view, uint32_t> offsets_;
+        };
+
+        // Checksum of a section, chained through seed. Eight bytes at a time in four
+        // independent lanes, so it keeps up with reading the mapped tables.
+        uint64_t Checksum(const void* data, size_t size, uint64_t seed) {
+            constexpr uint64_t MULTIPLIER = 0x9e3779b97f4a7c15ull;
+            const char* bytes = static_cast<const char*>(data);
+            uint64_t lanes[4] = {seed, seed + 1, seed + 2, seed + 3};
+            size_t i = 0;
+            for (; i + sizeof(lanes) <= size; i += sizeof(lanes)){
+                for (size_t lane = 0; lane < 4; ++lane){
+                    uint64_t word;
+                    std::memcpy(&word, bytes + i + lane * sizeof(word), sizeof(word));
+                    lanes[lane] = (lanes[lane] ^ word) * MULTIPLIER;
+                    lanes[lane] ^= lanes[lane] >> 29;
+                }
+            }
+            uint64_t hash = Hash(std::string_view(bytes + i, size - i), seed);
+            for (const uint64_t lane : lanes){
+                hash = (hash ^ lane) * MULTIPLIER;
+            }
+            return hash ^ size;
+        }
+
+        void WriteAt(std::ofstream& out, size_t offset, const void* data, size_t size) {
+            out.seekp(static_cast<std::streamoff>(offset));
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        }
+    }
+
+    uint64_t Hash(std::string_view data, uint64_t seed) {
+        uint64_t hash = seed;
+        for (const char c : data){
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    MappedFile::MappedFile(const std::string& path) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0){
+            throw std::runtime_error("Can't open "s + path);
+        }
+        struct stat info{};
+        if (fstat(fd, &info) != 0 || info.st_size == 0){
+            close(fd);
+            throw std::runtime_error("Can't map "s + path);
+        }
+        void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED){
+            throw std::runtime_error("Can't map "s + path);
+        }
+        data_ = static_cast<const char*>(data);
+        size_ = static_cast<size_t>(info.st_size);
+    }
+
+    MappedFile::~MappedFile() {
+        munmap(const_cast<char*>(data_), size_);
+    }
+
+    PrecomputedRouter::Sections PrecomputedRouter::GetSections(const Header& header) {
+        const size_t table_size = header.vertex_count * header.vertex_count;
+        Sections sections{};
+        sections.edges = AlignUp(sizeof(Header));
+        sections.stops = AlignUp(sections.edges + header.edge_count * sizeof(Edge));
+        sections.names = AlignUp(sections.stops + header.stop_count * sizeof(Stop));
+        sections.weights = AlignUp(sections.names + header.names_size);
+        sections.route_edges = AlignUp(sections.weights + table_size * sizeof(double));
+        sections.total = sections.route_edges + table_size * sizeof(RouteEdge);
+        return sections;
+    }
+
+    PrecomputedRouter::PrecomputedRouter(std::unique_ptr<MappedFile> file, Sections sections)
+        : file_(std::move(file))
+        , sections_(sections){}
+
+    std::unique_ptr<PrecomputedRouter> PrecomputedRouter::Open(const std::string& path, uint64_t input_hash) {
+        std::unique_ptr<MappedFile> file;
+        try {
+            file = std::make_unique<MappedFile>(path);
+        } catch (const std::runtime_error&) {
+            return nullptr;
+        }
+        if (file -> GetSize() < sizeof(Header)){
+            return nullptr;
+        }
+
+        const Header& header = *reinterpret_cast<const Header*>(file -> GetData());
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+            || header.version != VERSION
+            || header.weight_size != sizeof(double)
+            || header.input_hash != input_hash){
+            return nullptr;
+        }
+        // Counts too large for the file would overflow the section offsets.
+        const size_t size = file -> GetSize();
+        const size_t table_entry_size = sizeof(double) + sizeof(RouteEdge);
+        if (header.edge_count > size / sizeof(Edge)
+            || header.stop_count > size / sizeof(Stop)
+            || header.names_size > size
+            || (header.vertex_count != 0 && header.vertex_count > size / header.vertex_count / table_entry_size)){
+            return nullptr;
+        }
+        const Sections sections = GetSections(header);
+        if (sections.total != size){
+            return nullptr;
+        }
+
+        std::unique_ptr<PrecomputedRouter> router(new PrecomputedRouter(std::move(file), sections));
+        if (router -> ComputeChecksum() != header.checksum || !router -> IsConsistent()){
+            return nullptr;
+        }
+        return router;
+    }
+
+    uint64_t PrecomputedRouter::ComputeChecksum() const {
+        const Header& header = GetHeader();
+        const size_t table_size = header.vertex_count * header.vertex_count;
+        uint64_t checksum = header.input_hash;
+        checksum = Checksum(GetEdges(), header.edge_count * sizeof(Edge), checksum);
+        checksum = Checksum(GetStops(), header.stop_count * sizeof(Stop), checksum);
+        checksum = Checksum(GetNames(), header.names_size, checksum);
+        checksum = Checksum(GetWeights(), table_size * sizeof(double), checksum);
+        return Checksum(GetRouteEdges(), table_size * sizeof(RouteEdge), checksum);
+    }
+
+    bool PrecomputedRouter::IsConsistent() const {
+        const Header& header = GetHeader();
+        const auto is_name = [&header](uint32_t offset, uint32_t size){
+            return offset <= header.names_size && size <= header.names_size - offset;
+        };
+
+        // Route edge tables index edges with 32-bit ids below the two markers.
+        if (header.edge_count >= AllPairsRouter::NO_EDGE){
+            return false;
+        }
+        const Edge* edges = GetEdges();
+        for (size_t i = 0; i < header.edge_count; ++i){
+            const Edge& edge = edges[i];
+            if (edge.from >= header.vertex_count || edge.to >= header.vertex_count
+                || !is_name(edge.name_offset, edge.name_size)
+                || edge.action > static_cast<uint32_t>(RoutesType::ALIGHT)){
+                return false;
+            }
+        }
+
+        const Stop* stops = GetStops();
+        for (size_t i = 0; i < header.stop_count; ++i){
+            if (stops[i].vertex >= header.vertex_count || !is_name(stops[i].name_offset, stops[i].name_size)){
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void PrecomputedRouter::Save(const std::string& path, uint64_t input_hash,
+                                 const graph::DirectedWeightedGraph<EdgeWeight>& graph,
+                                 const std::vector<EdgeInfo>& edge_infos,
+                                 const std::unordered_map<std::string_view, size_t>& stop_vertices,
+                                 const graph::Router<EdgeWeight>& router) {
+        NamesWriter names;
+
+        std::vector<Edge> edges;
+        edges.reserve(graph.GetEdgeCount());
+        for (graph::EdgeId id = 0; id < graph.GetEdgeCount(); ++id){
+            const auto& edge = graph.GetEdge(id);
+            const EdgeInfo& info = edge_infos[id];
+            const auto [offset, size] = names.Add(info.name);
+            edges.push_back({
+                edge.from, edge.to, edge.weight, offset, size,
+                info.span_count, static_cast<uint32_t>(info.action)
+            });
+        }
+
+        std::vector<Stop> stops;
+        stops.reserve(stop_vertices.size());
+        for (const auto& [name, vertex] : stop_vertices){
+            const auto [offset, size] = names.Add(name);
+            stops.push_back({offset, size, vertex});
+        }
+
+        Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.weight_size = sizeof(double);
+        header.input_hash = input_hash;
+        header.vertex_count = graph.GetVertexCount();
+        header.edge_count = edges.size();
+        header.stop_count = stops.size();
+        header.names_size = names.GetNames().size();
+        const size_t table_size = header.vertex_count * header.vertex_count;
+        header.checksum = Checksum(edges.data(), edges.size() * sizeof(Edge), input_hash);
+        header.checksum = Checksum(stops.data(), stops.size() * sizeof(Stop), header.checksum);
+        header.checksum = Checksum(names.GetNames().data(), names.GetNames().size(), header.checksum);
+        header.checksum = Checksum(router.GetWeightTable(), table_size * sizeof(double), header.checksum);
+        header.checksum = Checksum(router.GetRouteEdgeTable(), table_size * sizeof(RouteEdge), header.checksum);
+
+        const Sections sections = GetSections(header);
+
+        // Written next to the target and renamed, so a reader never maps a half-written file.
+        const std::string temp_path = path + ".tmp"s;
+        {
+            std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+            if (!out){
+                throw std::runtime_error("Can't write "s + temp_path);
+            }
+            WriteAt(out, 0, &header, sizeof(header));
+            WriteAt(out, sections.edges, edges.data(), edges.size() * sizeof(Edge));
+            WriteAt(out, sections.stops, stops.data(), stops.size() * sizeof(Stop));
+            WriteAt(out, sections.names, names.GetNames().data(), names.GetNames().size());
+            WriteAt(out, sections.weights, router.GetWeightTable(), table_size * sizeof(double));
+            WriteAt(out, sections.route_edges, router.GetRouteEdgeTable(), table_size * sizeof(RouteEdge));
+            if (!out){
+                throw std::runtime_error("Can't write "s + temp_path);
+            }
+        }
+        if (std::rename(temp_path.c_str(), path.c_str()) != 0){
+            std::remove(temp_path.c_str());
+            throw std::runtime_error("Can't write "s + path);
+        }
+    }
+
+    const PrecomputedRouter::Header& PrecomputedRouter::GetHeader() const {
+        return *reinterpret_cast<const Header*>(file_ -> GetData());
+    }
+
+    size_t PrecomputedRouter::GetVertexCount() const {
+        return GetHeader().vertex_count;
+    }
+
+    const PrecomputedRouter::Edge* PrecomputedRouter::GetEdges() const {
+        return reinterpret_cast<const Edge*>(file_ -> GetData() + sections_.edges);
+    }
+
+    const PrecomputedRouter::Stop* PrecomputedRouter::GetStops() const {
+        return reinterpret_cast<const Stop*>(file_ -> GetData() + sections_.stops);
+    }
+
+    const char* PrecomputedRouter::GetNames() const {
+        return file_ -> GetData() + sections_.names;
+    }
+
+    const double* PrecomputedRouter::GetWeights() const {
+        return reinterpret_cast<const double*>(file_ -> GetData() + sections_.weights);
+    }
+
+    const RouteEdge* PrecomputedRouter::GetRouteEdges() const {
+        return reinterpret_cast<const RouteEdge*>(file_ -> GetData() + sections_.route_edges);
+    }
+
+    graph::DirectedWeightedGraph<EdgeWeight> PrecomputedRouter::LoadGraph() const {
+        const Header& header = GetHeader();
+        const Edge* edges = GetEdges();
+
+        graph::DirectedWeightedGraph<EdgeWeight> graph(header.vertex_count);
+        for (size_t i = 0; i < header.edge_count; ++i){
+            graph.AddEdge({edges[i].from, edges[i].to, edges[i].time});
+        }
+        return graph;
+    }
+
+    std::vector<EdgeInfo> PrecomputedRouter::LoadEdgeInfos() const {
+        const Header& header = GetHeader();
+        const Edge* edges = GetEdges();
+        const char* names = GetNames();
+
+        std::vector<EdgeInfo> edge_infos;
+        edge_infos.reserve(header.edge_count);
+        for (size_t i = 0; i < header.edge_count; ++i){
+            const Edge& edge = edges[i];
+            edge_infos.push_back({
+                std::string_view(names + edge.name_offset, edge.name_size),
+                static_cast<RoutesType>(edge.action),
+                edge.span_counter
+            });
+        }
+        return edge_infos;
+    }
+
+    std::vector<std::pair<std::string_view, size_t>> PrecomputedRouter::LoadStopVertices() const {
+        const Header& header = GetHeader();
+        const Stop* stops = GetStops();
+        const char* names = GetNames();
+
+        std::vector<std::pair<std::string_view, size_t>> result;
+        result.reserve(header.stop_count);
+        for (size_t i = 0; i < header.stop_count; ++i){
+            result.emplace_back(std::string_view(names + stops[i].name_offset, stops[i].name_size), stops[i].vertex);
+        }
+        return result;
+    }
+}
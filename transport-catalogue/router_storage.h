@@ -0,0 +1,108 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+#include "transport_router.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace router_storage {
+
+    // Read-only memory mapping of a whole file.
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* GetData() const {
+            return data_;
+        }
+
+        size_t GetSize() const {
+            return size_;
+        }
+
+    private:
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    // Routing graph, frozen so edges are stored by source, and all-pairs tables of one
+    // input, laid out as
+    //   Header | Edge[edge_count] | Stop[stop_count] | names | weights[V*V] | route_edges[V*V]
+    // with every section aligned to 8 bytes. The header keeps a checksum of the sections
+    // taken when they were saved. Names of edges and stops point into the mapping, so it
+    // has to stay alive as long as anything built from it.
+    class PrecomputedRouter {
+    public:
+        static constexpr uint32_t VERSION = 3;
+
+        // Maps path and checks it was written by this VERSION for this input hash, that
+        // the sections match their checksum, and that every vertex and name the graph
+        // refers to is in range. Returns nullptr when the file is missing, stale or
+        // damaged.
+        static std::unique_ptr<PrecomputedRouter> Open(const std::string& path, uint64_t input_hash);
+
+        static void Save(const std::string& path, uint64_t input_hash,
+                         const graph::DirectedWeightedGraph<EdgeWeight>& graph,
+                         const std::vector<EdgeInfo>& edge_infos,
+                         const std::unordered_map<std::string_view, size_t>& stop_vertices,
+                         const graph::Router<EdgeWeight>& router);
+
+        size_t GetVertexCount() const;
+
+        graph::DirectedWeightedGraph<EdgeWeight> LoadGraph() const;
+
+        std::vector<EdgeInfo> LoadEdgeInfos() const;
+
+        std::vector<std::pair<std::string_view, size_t>> LoadStopVertices() const;
+
+        const double* GetWeights() const;
+
+        const graph::Router<EdgeWeight>::RouteEdge* GetRouteEdges() const;
+
+    private:
+        struct Header;
+        struct Edge;
+        struct Stop;
+
+        // Byte offsets of the file sections.
+        struct Sections {
+            size_t edges;
+            size_t stops;
+            size_t names;
+            size_t weights;
+            size_t route_edges;
+            size_t total;
+        };
+
+        static Sections GetSections(const Header& header);
+
+        PrecomputedRouter(std::unique_ptr<MappedFile> file, Sections sections);
+
+        // Whether every vertex and name the edges and stops refer to lies inside the file.
+        bool IsConsistent() const;
+        uint64_t ComputeChecksum() const;
+
+        const Header& GetHeader() const;
+        const Edge* GetEdges() const;
+        const Stop* GetStops() const;
+        const char* GetNames() const;
+
+        std::unique_ptr<MappedFile> file_;
+        Sections sections_;
+    };
+
+    // FNV-1a, used to key precomputed files by the input they were built from.
+    uint64_t Hash(std::string_view data, uint64_t seed = 14695981039346656037ull);
+}
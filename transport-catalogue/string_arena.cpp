@@ -0,0 +1,40 @@
+#include "string_arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace strings {
+
+    std::string_view StringArena::Store(std::string_view text){
+        ++stats_.strings;
+        if (text.empty()){
+            return {};
+        }
+        if (text.size() > free_size_){
+            // A string longer than the next block gets a block of its own, and the current
+            // block keeps its free tail for the strings after it.
+            if (text.size() > next_block_size_){
+                auto& block = blocks_.emplace_back(new char[text.size()]);
+                std::memcpy(block.get(), text.data(), text.size());
+                stats_.used_bytes += text.size();
+                stats_.reserved_bytes += text.size();
+                return {block.get(), text.size()};
+            }
+            free_ = blocks_.emplace_back(new char[next_block_size_]).get();
+            free_size_ = next_block_size_;
+            stats_.reserved_bytes += next_block_size_;
+            next_block_size_ = std::min(next_block_size_ * 2, MAX_BLOCK_SIZE);
+        }
+        std::memcpy(free_, text.data(), text.size());
+        const std::string_view stored{free_, text.size()};
+        free_ += text.size();
+        free_size_ -= text.size();
+        stats_.used_bytes += text.size();
+        return stored;
+    }
+
+    ArenaStats StringArena::GetStats() const {
+        return stats_;
+    }
+}
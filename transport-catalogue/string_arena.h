@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdlib>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+
+namespace strings {
+
+    struct ArenaStats {
+        size_t strings = 0;
+        // Characters stored and the blocks reserved for them.
+        size_t used_bytes = 0;
+        size_t reserved_bytes = 0;
+    };
+
+    // Append-only arena of strings packed into blocks that never move, so the views Store
+    // returns stay valid for the life of the arena, moves included. Blocks double from
+    // MIN_BLOCK_SIZE up to MAX_BLOCK_SIZE, which keeps small catalogues small and large
+    // ones in few allocations. Not thread-safe; strings are stored while loading.
+    class StringArena {
+    public:
+        static constexpr size_t MIN_BLOCK_SIZE = 1 << 12;
+        static constexpr size_t MAX_BLOCK_SIZE = 1 << 20;
+
+        StringArena() = default;
+
+        StringArena(const StringArena&) = delete;
+        StringArena& operator=(const StringArena&) = delete;
+        StringArena(StringArena&&) = default;
+        StringArena& operator=(StringArena&&) = default;
+
+        std::string_view Store(std::string_view text);
+
+        ArenaStats GetStats() const;
+
+    private:
+        std::vector<std::unique_ptr<char[]>> blocks_;
+        size_t next_block_size_ = MIN_BLOCK_SIZE;
+        char* free_ = nullptr;
+        size_t free_size_ = 0;
+        ArenaStats stats_;
+    };
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace graph {
+
+// Strongly connected components of a frozen graph, found once with an iterative Tarjan
+// search, and the weakly connected components they form.
+//
+// Tarjan numbers components in reverse topological order: a component is finished
+// before every component that reaches it. So a route from u to v exists only if both
+// share a weak component and u's strong component is numbered no lower than v's, and
+// MayReach rules out every other pair with two lookups.
+class StrongComponents {
+public:
+    using ComponentId = uint32_t;
+
+    struct Stats {
+        size_t strong_count = 0;
+        size_t largest_strong = 0;
+        // Components of one vertex, such as stops no bus leaves from.
+        size_t single_vertex = 0;
+        size_t weak_count = 0;
+        size_t largest_weak = 0;
+    };
+
+    StrongComponents() = default;
+
+    template <typename Weight>
+    explicit StrongComponents(const DirectedWeightedGraph<Weight>& graph);
+
+    // False when no route leads from from to to; true when one may.
+    bool MayReach(VertexId from, VertexId to) const {
+        return weak_[from] == weak_[to] && strong_[from] >= strong_[to];
+    }
+
+    ComponentId GetComponent(VertexId vertex) const {
+        return strong_[vertex];
+    }
+
+    size_t GetComponentCount() const {
+        return strong_sizes_.size();
+    }
+
+    size_t GetComponentSize(ComponentId component) const {
+        return strong_sizes_.at(component);
+    }
+
+    Stats GetStats() const;
+
+private:
+    static constexpr ComponentId NONE = std::numeric_limits<ComponentId>::max();
+
+    template <typename Weight>
+    void FindStrong(const DirectedWeightedGraph<Weight>& graph);
+
+    template <typename Weight>
+    void FindWeak(const DirectedWeightedGraph<Weight>& graph);
+
+    std::vector<ComponentId> strong_;
+    std::vector<ComponentId> weak_;
+    std::vector<size_t> strong_sizes_;
+    std::vector<size_t> weak_sizes_;
+};
+
+template <typename Weight>
+StrongComponents::StrongComponents(const DirectedWeightedGraph<Weight>& graph) {
+    if (graph.GetVertexCount() >= NONE) {
+        throw std::length_error("Too many vertices for 32-bit component ids");
+    }
+    FindStrong(graph);
+    FindWeak(graph);
+}
+
+template <typename Weight>
+void StrongComponents::FindStrong(const DirectedWeightedGraph<Weight>& graph) {
+    const size_t vertex_count = graph.GetVertexCount();
+    strong_.assign(vertex_count, NONE);
+
+    // Discovery order and lowest reachable order of every vertex on the search stack.
+    std::vector<uint32_t> order(vertex_count, NONE);
+    std::vector<uint32_t> low(vertex_count);
+    std::vector<VertexId> stack;
+    // The search path, each vertex with the next of its edges to follow.
+    std::vector<std::pair<VertexId, EdgeId>> path;
+    uint32_t next_order = 0;
+
+    for (VertexId root = 0; root < vertex_count; ++root) {
+        if (order[root] != NONE) {
+            continue;
+        }
+        order[root] = low[root] = next_order++;
+        stack.push_back(root);
+        path.push_back({root, *graph.GetIncidentEdges(root).begin()});
+
+        while (!path.empty()) {
+            auto& [vertex, next_edge] = path.back();
+            if (next_edge != *graph.GetIncidentEdges(vertex).end()) {
+                const VertexId target = graph.GetEdge(next_edge++).to;
+                if (order[target] == NONE) {
+                    order[target] = low[target] = next_order++;
+                    stack.push_back(target);
+                    path.push_back({target, *graph.GetIncidentEdges(target).begin()});
+                } else if (strong_[target] == NONE) {
+                    low[vertex] = std::min(low[vertex], order[target]);
+                }
+                continue;
+            }
+
+            const VertexId finished = vertex;
+            path.pop_back();
+            if (!path.empty()) {
+                low[path.back().first] = std::min(low[path.back().first], low[finished]);
+            }
+            if (low[finished] != order[finished]) {
+                continue;
+            }
+            const auto component = static_cast<ComponentId>(strong_sizes_.size());
+            size_t size = 0;
+            VertexId member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                strong_[member] = component;
+                ++size;
+            } while (member != finished);
+            strong_sizes_.push_back(size);
+        }
+    }
+}
+
+template <typename Weight>
+void StrongComponents::FindWeak(const DirectedWeightedGraph<Weight>& graph) {
+    // Union-find over strong components: an edge joins the components of its ends.
+    std::vector<ComponentId> parent(strong_sizes_.size());
+    for (ComponentId component = 0; component < parent.size(); ++component) {
+        parent[component] = component;
+    }
+    const auto find = [&parent](ComponentId component) {
+        while (parent[component] != component) {
+            component = parent[component] = parent[parent[component]];
+        }
+        return component;
+    };
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        const ComponentId from = find(strong_[edge.from]);
+        const ComponentId to = find(strong_[edge.to]);
+        if (from != to) {
+            parent[std::max(from, to)] = std::min(from, to);
+        }
+    }
+
+    std::vector<ComponentId> weak_of_strong(parent.size(), NONE);
+    for (ComponentId component = 0; component < parent.size(); ++component) {
+        ComponentId& root_id = weak_of_strong[find(component)];
+        if (root_id == NONE) {
+            root_id = static_cast<ComponentId>(weak_sizes_.size());
+            weak_sizes_.push_back(0);
+        }
+        weak_of_strong[component] = root_id;
+        weak_sizes_[root_id] += strong_sizes_[component];
+    }
+
+    weak_.resize(strong_.size());
+    for (VertexId vertex = 0; vertex < strong_.size(); ++vertex) {
+        weak_[vertex] = weak_of_strong[strong_[vertex]];
+    }
+}
+
+inline StrongComponents::Stats StrongComponents::GetStats() const {
+    Stats stats;
+    stats.strong_count = strong_sizes_.size();
+    stats.weak_count = weak_sizes_.size();
+    for (const size_t size : strong_sizes_) {
+        stats.largest_strong = std::max(stats.largest_strong, size);
+        stats.single_vertex += size == 1;
+    }
+    for (const size_t size : weak_sizes_) {
+        stats.largest_weak = std::max(stats.largest_weak, size);
+    }
+    return stats;
+}
+
+}
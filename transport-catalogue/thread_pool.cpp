@@ -0,0 +1,55 @@
+#include "thread_pool.h"
+
+namespace parallel {
+
+    size_t DefaultThreadCount() {
+        const size_t hardware = std::thread::hardware_concurrency();
+        return hardware == 0 ? 1 : hardware;
+    }
+
+    ThreadPool::ThreadPool(size_t thread_count) {
+        // The thread that waits on a batch works on it as well, so one thread fewer is enough.
+        for (size_t i = 1; i < thread_count; ++i){
+            workers_.emplace_back([this](){ WorkerLoop(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard lock(mutex_);
+            is_stopping_ = true;
+        }
+        has_jobs_.notify_all();
+        for (auto& worker : workers_){
+            worker.join();
+        }
+    }
+
+    size_t ThreadPool::GetThreadCount() const {
+        return workers_.size() + 1;
+    }
+
+    void ThreadPool::Enqueue(std::function<void()> job) {
+        {
+            std::lock_guard lock(mutex_);
+            jobs_.push(std::move(job));
+        }
+        has_jobs_.notify_one();
+    }
+
+    void ThreadPool::WorkerLoop() {
+        while (true){
+            std::function<void()> job;
+            {
+                std::unique_lock lock(mutex_);
+                has_jobs_.wait(lock, [this](){ return is_stopping_ || !jobs_.empty(); });
+                if (jobs_.empty()){
+                    return;
+                }
+                job = std::move(jobs_.front());
+                jobs_.pop();
+            }
+            job();
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+namespace parallel {
+
+    size_t DefaultThreadCount();
+
+    class ThreadPool {
+    public:
+        explicit ThreadPool(size_t thread_count = DefaultThreadCount());
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        size_t GetThreadCount() const;
+
+        template <typename Function>
+        auto Submit(Function function) -> std::future<std::invoke_result_t<Function>>;
+
+        // Calls task(index) for every index in [0, count) and returns once all of them are
+        // done. The calling thread takes tasks too, so a pool of one thread runs inline.
+        template <typename Task>
+        void ParallelFor(size_t count, Task&& task);
+
+    private:
+        void Enqueue(std::function<void()> job);
+        void WorkerLoop();
+
+        std::vector<std::thread> workers_;
+        std::queue<std::function<void()>> jobs_;
+        std::mutex mutex_;
+        std::condition_variable has_jobs_;
+        bool is_stopping_ = false;
+    };
+
+    template <typename Function>
+    auto ThreadPool::Submit(Function function) -> std::future<std::invoke_result_t<Function>> {
+        using Result = std::invoke_result_t<Function>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+        std::future<Result> result = task -> get_future();
+        if (workers_.empty()){
+            (*task)();
+        } else {
+            Enqueue([task](){ (*task)(); });
+        }
+        return result;
+    }
+
+    template <typename Task>
+    void ThreadPool::ParallelFor(size_t count, Task&& task) {
+        struct Batch {
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> done{0};
+            std::exception_ptr error;
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+        const auto batch = std::make_shared<Batch>();
+
+        const auto run = [batch, count, &task](){
+            for (size_t index = batch -> next++; index < count; index = batch -> next++){
+                try {
+                    task(index);
+                } catch (...) {
+                    std::lock_guard lock(batch -> mutex);
+                    if (!batch -> error){
+                        batch -> error = std::current_exception();
+                    }
+                }
+                if (++(batch -> done) == count){
+                    std::lock_guard lock(batch -> mutex);
+                    batch -> finished.notify_all();
+                }
+            }
+        };
+
+        const size_t helpers = std::min(workers_.size(), count > 0 ? count - 1 : 0);
+        for (size_t i = 0; i < helpers; ++i){
+            Enqueue(run);
+        }
+        run();
+
+        std::unique_lock lock(batch -> mutex);
+        batch -> finished.wait(lock, [&batch, count](){ return batch -> done == count; });
+        if (batch -> error){
+            std::rethrow_exception(batch -> error);
+        }
+    }
+}
@@ -1,13 +1,32 @@
 #include "transport_catalogue.h"
 
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
 namespace transport_directory{
 
-        double RootDistance(const std::deque<Stop *>& stops)
+    using namespace std::literals;
+
+    namespace {
+        // Returned for unknown names. Built before main, so concurrent readers never race on
+        // their initialization. Their ids are past any table, so they list nothing.
+        const Stop EMPTY_STOP{{}, {}, std::numeric_limits<StopId>::max()};
+        const Bus EMPTY_BUS{{}, false, std::numeric_limits<BusId>::max()};
+        const BusStats EMPTY_BUS_STATS;
+
+        // Longest string a std::string keeps inside the object.
+        const size_t SMALL_STRING_CAPACITY = std::string().capacity();
+    }
+
+        double RootDistance(const StopList& stops)
     {
         double result = 0.0;
-        Stop* previos_stop = nullptr;
+        const Stop* previos_stop = nullptr;
 
-        for (const auto& stop : stops){
+        for (const auto stop : stops){
             if (previos_stop == nullptr){
                 previos_stop = stop;
                 continue;
@@ -19,104 +38,242 @@ namespace transport_directory{
         return result;
     }
 
-    int RealDistance(const TransportCatalogue& transport_catalogue,
-        const std::deque<Stop *>& stops)
-    {
-        int result = 0;
-        Stop* previos_stop = nullptr;
-
-        for (const auto& stop : stops){
-            if (previos_stop == nullptr){
-                previos_stop = stop;
-                continue;
-            }
-            result += transport_catalogue.GetDistance(
-                previos_stop, stop
-            );
-            previos_stop = stop;
+    std::string_view TransportCatalogue::InternName(std::string_view name){
+        ++name_stats_.names;
+        name_stats_.string_bytes += sizeof(std::string) + (name.size() > SMALL_STRING_CAPACITY ? name.size() + 1 : 0);
+        // The name indexes already hold every stored name, so interning needs no set of
+        // its own.
+        if (const auto it = stopname_to_stop_.find(name); it != stopname_to_stop_.end()){
+            return stops_[it -> second].name;
         }
-
-        return result;
+        if (const auto it = busname_to_root_.find(name); it != busname_to_root_.end()){
+            return buses_[it -> second].name;
+        }
+        ++name_stats_.unique;
+        return names_.Store(name);
     }
 
     void TransportCatalogue::AddStop(const std::string& name, geo::Coordinates coordinates){
-        Stop stop;
-        stop.name = name;
-        stop.coordinates = std::move(coordinates);
-        stops_.push_back(std::move(stop));
-        auto stop_pointer = &stops_.back();
-        stopname_to_stop_[name] = std::move(stop_pointer);
+        if (stops_.size() >= std::numeric_limits<StopId>::max()){
+            throw std::length_error("Too many stops for 32-bit stop ids");
+        }
+        const auto id = static_cast<StopId>(stops_.size());
+        const std::string_view stored_name = InternName(name);
+        stops_.push_back({stored_name, std::move(coordinates), id});
+        stopname_to_stop_[stored_name] = id;
+        stop_bus_offsets_.clear();
     }
 
     void TransportCatalogue::AddBusBy(
-        const std::string& name, Bus&& bus,
-        const std::vector<std::string_view>& string_stops){
-        buses_.push_back(bus);
-        auto bus_pointer = &buses_.back();
+        Bus&& bus, const std::vector<std::string_view>& string_stops){
+        if (buses_.size() >= std::numeric_limits<BusId>::max()){
+            throw std::length_error("Too many buses for 32-bit bus ids");
+        }
+        bus.id = static_cast<BusId>(buses_.size());
 
         for (const auto& s : string_stops){
-            Stop *stop = stopname_to_stop_.at(s);
-            bus_pointer -> stops.push_back(stop);
-            stop -> buses.insert(bus_pointer);
+            bus_stops_.push_back(stopname_to_stop_.at(s));
         }
+        bus_stop_offsets_.push_back(bus_stops_.size());
 
-        busname_to_root_[name] = std::move(bus_pointer);
+        busname_to_root_[bus.name] = bus.id;
+        buses_.push_back(std::move(bus));
+        stop_bus_offsets_.clear();
     }
 
     void TransportCatalogue::AddBus(
         const std::string& name, const std::vector<std::string_view>& string_stops){
 
-        AddBusBy(name, Bus{name}, string_stops);
+        AddBusBy(Bus{InternName(name)}, string_stops);
     }
 
     void TransportCatalogue::AddBus(
         const std::string& name, bool is_roundtrip,
         const std::vector<std::string_view>& string_stops
     ){
-        AddBusBy(name, Bus{name, is_roundtrip}, string_stops);
+        AddBusBy(Bus{InternName(name), is_roundtrip}, string_stops);
     }
 
     void TransportCatalogue::AddRealDistance(std::string_view from_stopname,
                                              int distance,
                                              std::string_view to_stopname)
     {
-        Stop* first = stopname_to_stop_.at(from_stopname);
-        Stop* second = stopname_to_stop_.at(to_stopname);
-        real_distance_.insert({std::make_pair(first, second), distance});
+        const StopId first = stopname_to_stop_.at(from_stopname);
+        const StopId second = stopname_to_stop_.at(to_stopname);
+        real_distance_.Insert(first, second, distance);
+        stop_bus_offsets_.clear();
     }
 
-    const Stop* TransportCatalogue::GetStop(std::string_view name) const {
-        static const Stop& empty_stop = Stop{};
+    void TransportCatalogue::Freeze(size_t thread_count){
+        if (IsFrozen()){
+            return;
+        }
+
+        // A counting sort over the buses in name order, skipping a stop the bus has already
+        // passed, keeps every stop's buses unique and sorted by name, as Stop requests list
+        // them. The stops it does not skip are the bus's unique stops.
+        std::vector<BusId> by_name(buses_.size());
+        std::iota(by_name.begin(), by_name.end(), BusId{0});
+        std::sort(by_name.begin(), by_name.end(), [this](BusId lhs, BusId rhs){
+            return buses_[lhs].name < buses_[rhs].name;
+        });
+
+        std::vector<BusId> last_bus(stops_.size(), std::numeric_limits<BusId>::max());
+        stop_bus_offsets_.assign(stops_.size() + 1, 0);
+        bus_stats_.assign(buses_.size(), BusStats{});
+        for (const BusId bus : by_name){
+            for (size_t i = bus_stop_offsets_[bus]; i < bus_stop_offsets_[bus + 1]; ++i){
+                const StopId stop = bus_stops_[i];
+                if (last_bus[stop] != bus){
+                    last_bus[stop] = bus;
+                    ++stop_bus_offsets_[stop + 1];
+                    ++bus_stats_[bus].unique_stop_count;
+                }
+            }
+        }
+        for (StopId stop = 0; stop < stops_.size(); ++stop){
+            stop_bus_offsets_[stop + 1] += stop_bus_offsets_[stop];
+        }
+
+        stop_buses_.resize(stop_bus_offsets_.back());
+        std::vector<size_t> next(stop_bus_offsets_.begin(), stop_bus_offsets_.end() - 1);
+        last_bus.assign(stops_.size(), std::numeric_limits<BusId>::max());
+        for (const BusId bus : by_name){
+            for (size_t i = bus_stop_offsets_[bus]; i < bus_stop_offsets_[bus + 1]; ++i){
+                const StopId stop = bus_stops_[i];
+                if (last_bus[stop] != bus){
+                    last_bus[stop] = bus;
+                    stop_buses_[next[stop]++] = bus;
+                }
+            }
+        }
+
+        bus_distances_.assign(bus_stops_.size(), 0);
+        bus_missing_distance_.assign(buses_.size(), false);
+        for (BusId bus = 0; bus < buses_.size(); ++bus){
+            for (size_t i = bus_stop_offsets_[bus]; i + 1 < bus_stop_offsets_[bus + 1]; ++i){
+                const auto distance = real_distance_.Find(bus_stops_[i], bus_stops_[i + 1]);
+                if (!distance){
+                    bus_missing_distance_[bus] = true;
+                    continue;
+                }
+                bus_distances_[i] = *distance;
+            }
+        }
+
+        // Each task writes the stats of its own bus, and the great-circle lengths with a
+        // trigonometric call per step are most of the work.
+        parallel::ThreadPool pool(thread_count);
+        pool.ParallelFor(buses_.size(), [this](size_t bus){
+            BusStats& stats = bus_stats_[bus];
+            const size_t begin = bus_stop_offsets_[bus];
+            const size_t end = bus_stop_offsets_[bus + 1];
+            stats.stop_count = static_cast<int>(end - begin);
+            for (size_t i = begin; i < end; ++i){
+                stats.route_length += bus_distances_[i];
+            }
+            stats.geo_length = RootDistance(GetBusStops(buses_[bus]));
+            stats.curvature = stats.route_length / stats.geo_length;
+        });
+    }
+
+    bool TransportCatalogue::IsFrozen() const {
+        return !stop_bus_offsets_.empty();
+    }
 
-        if (stopname_to_stop_.count(name) == 0){
-            return &empty_stop;
+    void TransportCatalogue::CheckFrozen() const {
+        if (!IsFrozen()){
+            throw std::logic_error("The catalogue is read before Freeze()"s);
         }
+    }
 
-        return stopname_to_stop_.at(name);
+    const Stop* TransportCatalogue::GetStop(std::string_view name) const {
+        const auto it = stopname_to_stop_.find(name);
+        if (it == stopname_to_stop_.end()){
+            return &EMPTY_STOP;
+        }
+        return &stops_[it -> second];
     }
 
     const Bus* TransportCatalogue::GetBus(std::string_view name) const {
-        static const Bus& empty_bus = Bus{};
+        const auto it = busname_to_root_.find(name);
+        if (it == busname_to_root_.end()){
+            return &EMPTY_BUS;
+        }
+        return &buses_[it -> second];
+    }
+
+    const Stop& TransportCatalogue::GetStop(StopId id) const {
+        assert(id < stops_.size());
+        return stops_[id];
+    }
 
-        if (busname_to_root_.count(name) == 0){
-            return &empty_bus;
+    const Bus& TransportCatalogue::GetBus(BusId id) const {
+        assert(id < buses_.size());
+        return buses_[id];
+    }
+
+    StopList TransportCatalogue::GetBusStops(const Bus& bus) const {
+        if (bus.id >= buses_.size()){
+            return {};
+        }
+        return {stops_.data(), bus_stops_.data() + bus_stop_offsets_[bus.id],
+                bus_stops_.data() + bus_stop_offsets_[bus.id + 1]};
+    }
+
+    BusList TransportCatalogue::GetStopBuses(const Stop& stop) const {
+        CheckFrozen();
+        if (stop.id >= stops_.size()){
+            return {};
+        }
+        return {buses_.data(), stop_buses_.data() + stop_bus_offsets_[stop.id],
+                stop_buses_.data() + stop_bus_offsets_[stop.id + 1]};
+    }
+
+    int TransportCatalogue::GetDistance(const Stop* from, const Stop* to_stop) const {
+        if (const auto distance = real_distance_.Find(from -> id, to_stop -> id)){
+            return *distance;
         }
+        throw std::out_of_range("No distance between stops "s + std::string(from -> name)
+                                + " and "s + std::string(to_stop -> name));
+    }
 
-        return busname_to_root_.at(name);
+    DistanceList TransportCatalogue::GetBusDistances(const Bus& bus) const {
+        CheckFrozen();
+        if (bus.id >= buses_.size()){
+            return {};
+        }
+        if (bus_missing_distance_[bus.id]){
+            throw std::out_of_range("No distance along a step of bus "s + std::string(bus.name));
+        }
+        return {bus_distances_.data() + bus_stop_offsets_[bus.id],
+                bus_distances_.data() + bus_stop_offsets_[bus.id + 1]};
     }
 
-    int TransportCatalogue::GetDistance(Stop* const from, Stop* const to_stop) const {
-        if (real_distance_.count(std::make_pair(from, to_stop)) != 0){
-            return real_distance_.at({from, to_stop});
+    const BusStats& TransportCatalogue::GetBusStats(const Bus& bus) const {
+        CheckFrozen();
+        if (bus.id >= buses_.size()){
+            return EMPTY_BUS_STATS;
         }
-        return real_distance_.at({to_stop, from});
+        if (bus_missing_distance_[bus.id]){
+            throw std::out_of_range("No distance along a step of bus "s + std::string(bus.name));
+        }
+        return bus_stats_[bus.id];
+    }
+
+    NameStats TransportCatalogue::GetNameStats() const {
+        NameStats stats = name_stats_;
+        const strings::ArenaStats arena = names_.GetStats();
+        stats.used_bytes = arena.used_bytes;
+        stats.interned_bytes = arena.reserved_bytes + stats.names * sizeof(std::string_view);
+        return stats;
     }
 
-    const std::list<Bus>& TransportCatalogue::GetAllBuses() const {
+    const std::vector<Bus>& TransportCatalogue::GetAllBuses() const {
         return buses_;
     }
 
-    const std::list<Stop>& TransportCatalogue::GetAllStops() const {
+    const std::vector<Stop>& TransportCatalogue::GetAllStops() const {
         return stops_;
     }
 }
\ No newline at end of file
@@ -1,11 +1,11 @@
 #pragma once
 
+#include "distance_table.h"
 #include "domain.h"
 #include "geo.h"
+#include "string_arena.h"
+#include "thread_pool.h"
 
-#include <deque>
-#include <functional>
-#include <list>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -16,31 +16,104 @@ namespace transport_directory{
 
     using namespace domain;
 
-    struct HashPairOfStops{
-        size_t operator()(
-            const std::pair<Stop *, Stop*>& stops) const {
-            return hasher(stops.first) + 7 * hasher(stops.second);
+    // Road distances along a bus, as many as its stops: entry i leads from stop i to
+    // stop i + 1, and the last is 0.
+    class DistanceList {
+    public:
+        DistanceList() = default;
+        DistanceList(const int* begin, const int* end)
+            : begin_(begin)
+            , end_(end){}
+
+        const int* begin() const {
+            return begin_;
+        }
+        const int* end() const {
+            return end_;
         }
 
-        std::hash<const void*> hasher;
-    };
+        size_t size() const {
+            return static_cast<size_t>(end_ - begin_);
+        }
+        bool empty() const {
+            return begin_ == end_;
+        }
+
+        int operator[](size_t index) const {
+            return begin_[index];
+        }
 
-    class TransportCatalogue {
     private:
-        std::list<Stop> stops_;
-        std::unordered_map<std::string_view, Stop*> stopname_to_stop_;
-        std::list<Bus> buses_;
-        std::unordered_map<std::string_view, Bus*> busname_to_root_;
+        const int* begin_ = nullptr;
+        const int* end_ = nullptr;
+    };
 
-        std::unordered_map<
-            std::pair<Stop *, Stop *>,
-            int, HashPairOfStops> real_distance_;
+    // What a Bus request answers, computed for every bus when the catalogue is frozen.
+    struct BusStats {
+        int stop_count = 0;
+        int unique_stop_count = 0;
+        // Road and great-circle lengths along the stops, and their ratio.
+        int route_length = 0;
+        double geo_length = 0.0;
+        double curvature = 0.0;
+    };
+
+    struct NameStats {
+        // Names given to the catalogue, and the distinct ones it stored.
+        size_t names = 0;
+        size_t unique = 0;
+        // The arena's characters and reserved blocks, plus a view per name in the records.
+        size_t used_bytes = 0;
+        size_t interned_bytes = 0;
+        // What a std::string per name would take: the object and, past the small-string
+        // capacity, a heap buffer.
+        size_t string_bytes = 0;
+    };
 
-        void AddBusBy(const std::string& name, Bus&& bus, const std::vector<std::string_view>& string_stops);
+    // Stops and buses live in vectors indexed by their ids. Each bus's stops are one run
+    // of a flat id array, and Freeze() sorts the buses of every stop by name into
+    // compressed sparse rows the same way. Freeze() also looks up the road distance of
+    // every step of every bus once, so walking a route reads an array, and computes the
+    // stats of every bus, so a Bus request reads one record. AddStop, AddBus and
+    // AddRealDistance unfreeze the catalogue, and what Freeze() builds can only be read
+    // while frozen. Records and lists handed out stay valid until the next Add call;
+    // names stay valid as long as the catalogue.
+    class TransportCatalogue {
+    private:
+        // Every stop and bus name once; records, the name indexes and everything built
+        // from the catalogue view it.
+        strings::StringArena names_;
+        NameStats name_stats_;
+
+        std::vector<Stop> stops_;
+        std::unordered_map<std::string_view, StopId> stopname_to_stop_;
+        std::vector<Bus> buses_;
+        std::unordered_map<std::string_view, BusId> busname_to_root_;
+
+        // Stops of bus b are bus_stops_[bus_stop_offsets_[b], bus_stop_offsets_[b + 1]).
+        std::vector<StopId> bus_stops_;
+        std::vector<size_t> bus_stop_offsets_{0};
+        // Buses through stop s, once each and by name, are the same run of stop_buses_;
+        // empty until frozen.
+        std::vector<BusId> stop_buses_;
+        std::vector<size_t> stop_bus_offsets_;
+
+        DistanceTable real_distance_;
+        // Distances along bus b are the same run of bus_distances_ as its stops; a bus with
+        // a step of no known distance is marked, and empty until frozen.
+        std::vector<int> bus_distances_;
+        std::vector<bool> bus_missing_distance_;
+        std::vector<BusStats> bus_stats_;
+
+        // The stored copy of name, shared with any stop or bus of the same name.
+        std::string_view InternName(std::string_view name);
+        void AddBusBy(Bus&& bus, const std::vector<std::string_view>& string_stops);
+        // Throws std::logic_error unless frozen.
+        void CheckFrozen() const;
     public:
 
-        const std::list<Bus>& GetAllBuses() const;
-        const std::list<Stop>& GetAllStops() const;
+        const std::vector<Bus>& GetAllBuses() const;
+        const std::vector<Stop>& GetAllStops() const;
 
         void AddStop(const std::string& name, geo::Coordinates coordinates);
 
@@ -53,15 +126,38 @@ namespace transport_directory{
                              int distance,
                              std::string_view to_stopname);
 
+        // Bus stats are computed on thread_count threads, the caller's included.
+        void Freeze(size_t thread_count = parallel::DefaultThreadCount());
+
+        bool IsFrozen() const;
+
+        // Unknown names give an Empty() record.
         const Stop* GetStop(std::string_view name) const;
 
         const Bus* GetBus(std::string_view id) const;
 
-        int GetDistance(Stop* const from, Stop* const to_stop) const;
-    };
+        const Stop& GetStop(StopId id) const;
+
+        const Bus& GetBus(BusId id) const;
 
-    double RootDistance(const std::deque<Stop *>& stops);
+        StopList GetBusStops(const Bus& bus) const;
+
+        // Sorted by name. Throws std::logic_error unless frozen.
+        BusList GetStopBuses(const Stop& stop) const;
+
+        // Throws std::out_of_range when no distance was given either way.
+        int GetDistance(const Stop* from, const Stop* to_stop) const;
+
+        // Throws std::logic_error unless frozen, and std::out_of_range when a step of the
+        // bus has no distance.
+        DistanceList GetBusDistances(const Bus& bus) const;
+
+        // Needs the catalogue frozen and throws as GetBusDistances does; an unknown bus has
+        // empty stats.
+        const BusStats& GetBusStats(const Bus& bus) const;
+
+        NameStats GetNameStats() const;
+    };
 
-    int RealDistance(const TransportCatalogue& transport_catalogue,
-        const std::deque<Stop *>& stops);
+    double RootDistance(const StopList& stops);
 }
\ No newline at end of file
@@ -1,61 +1,205 @@
 #include "transport_router.h"
+#include "router_storage.h"
 
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string_view>
 
-bool operator<(const EdgeWeight& lhs, const EdgeWeight& rhs){
-    return lhs.time_ < rhs.time_;
+
+void RouterHelper::LoadGraph(const transport_directory::TransportCatalogue& db){
+    if (settings_.router_type == RouterType::RAPTOR){
+        FreezeGraph();
+        return;
+    }
+
+    // Ride vertices go after the two vertices of every stop.
+    size_t ride_vertex = graph_.GetVertexCount();
+    if (settings_.graph_model == GraphModel::ROUTE_PATTERN){
+        size_t vertex_count = ride_vertex;
+        for (const auto& bus : db.GetAllBuses()){
+            vertex_count += db.GetBusStops(bus).size();
+        }
+        graph_ = graph::DirectedWeightedGraph<EdgeWeight>(vertex_count);
+        vertex_coordinates_.resize(vertex_count);
+    }
+
+    if (LoadPrecomputedGraph()){
+        SelectRouter();
+        return;
+    }
+
+    const double meters_per_min = (1000.0 / 60.0) * static_cast<double>(settings_.bus_velocity);
+    size_t index = 0;
+    std::vector<double> segment_times;
+
+    for (const auto& bus: db.GetAllBuses()){
+        const auto stops = db.GetBusStops(bus);
+        const auto distances = db.GetBusDistances(bus);
+        segment_times.clear();
+        for (size_t i = 1; i < stops.size(); ++i){
+            segment_times.push_back(distances[i - 1] / meters_per_min);
+        }
+
+        if (settings_.graph_model == GraphModel::ROUTE_PATTERN){
+            AddBusPattern(bus, stops, segment_times, index, ride_vertex);
+        } else {
+            AddBusEdges(bus, stops, segment_times, index);
+        }
+    }
+    FreezeGraph();
+    SelectRouter();
+}
+
+namespace {
+    // The all-pairs build is cubic in the vertex count: past this it takes minutes even
+    // when the tables fit.
+    constexpr size_t ALL_PAIRS_MAX_VERTICES = 4096;
+    // A contraction hierarchy keeps every edge and shortcut twice, as a hierarchy edge of
+    // about 48 bytes and an upward arc of 24. The bus graphs measured get between half
+    // and three times as many shortcuts as edges, so four entries per edge bound it.
+    constexpr size_t HIERARCHY_BYTES_PER_EDGE = 4 * (48 + 24);
+    // A Dijkstra search keeps a weight, a previous edge and a mark per vertex.
+    constexpr size_t SEARCH_BYTES_PER_VERTEX = sizeof(EdgeWeight) + 2 * sizeof(size_t);
+
+    std::string_view GetRouterName(RouterType type){
+        switch (type){
+            case RouterType::ALL_PAIRS:
+                return "all_pairs";
+            case RouterType::DIJKSTRA:
+                return "dijkstra";
+            case RouterType::CONTRACTION_HIERARCHY:
+                return "contraction_hierarchy";
+            case RouterType::ALT:
+                return "alt";
+            case RouterType::HUB_LABELS:
+                return "hub_labels";
+            case RouterType::RAPTOR:
+                return "raptor";
+            case RouterType::AUTO:
+                break;
+        }
+        return "auto";
+    }
+
+    constexpr size_t BYTES_PER_MEGABYTE = 1024 * 1024;
+
+    double ToMegabytes(size_t bytes){
+        return static_cast<double>(bytes) / static_cast<double>(BYTES_PER_MEGABYTE);
+    }
+
+    // Saturates, so a budget too large to count in bytes allows everything.
+    size_t ToBytes(size_t megabytes){
+        if (megabytes > std::numeric_limits<size_t>::max() / BYTES_PER_MEGABYTE){
+            return std::numeric_limits<size_t>::max();
+        }
+        return megabytes * BYTES_PER_MEGABYTE;
+    }
 }
 
-bool operator>(const EdgeWeight& lhs, const EdgeWeight& rhs){
-    return lhs.time_ > rhs.time_;
+// Prefers the fastest queries that fit the budget: all-pairs tables answer with a
+// lookup, a contraction hierarchy with a small search, and plain Dijkstra needs nothing
+// beyond the graph. Hub labels are left out, their size is only known once built.
+void RouterHelper::SelectRouter(){
+    if (settings_.router_type != RouterType::AUTO){
+        return;
+    }
+    const size_t vertex_count = graph_.GetVertexCount();
+    const size_t edge_count = graph_.GetEdgeCount();
+    const size_t budget = ToBytes(settings_.memory_budget_mb);
+    const size_t all_pairs_bytes = vertex_count * vertex_count
+        * (sizeof(EdgeWeight) + sizeof(graph::Router<EdgeWeight>::RouteEdge));
+    const size_t hierarchy_bytes = edge_count * HIERARCHY_BYTES_PER_EDGE;
+
+    std::ostringstream reason;
+    reason << std::fixed << std::setprecision(1);
+    if (all_pairs_bytes <= budget && vertex_count <= ALL_PAIRS_MAX_VERTICES){
+        settings_.router_type = RouterType::ALL_PAIRS;
+        reason << "tables take " << ToMegabytes(all_pairs_bytes) << " MB";
+    } else if (hierarchy_bytes <= budget){
+        settings_.router_type = RouterType::CONTRACTION_HIERARCHY;
+        if (vertex_count > ALL_PAIRS_MAX_VERTICES){
+            reason << "too many vertices for all-pairs tables";
+        } else {
+            reason << "all-pairs tables would take " << ToMegabytes(all_pairs_bytes) << " MB";
+        }
+        reason << ", the hierarchy about " << ToMegabytes(hierarchy_bytes) << " MB";
+    } else {
+        settings_.router_type = RouterType::DIJKSTRA;
+        reason << "a hierarchy would take about " << ToMegabytes(hierarchy_bytes) << " MB, searches take "
+               << ToMegabytes(vertex_count * SEARCH_BYTES_PER_VERTEX) << " MB per thread";
+    }
+    std::cerr << "auto router: " << GetRouterName(settings_.router_type) << " for "
+              << vertex_count << " vertices and " << edge_count << " edges within "
+              << settings_.memory_budget_mb << " MB: " << reason.str() << std::endl;
 }
 
-EdgeWeight operator+(const EdgeWeight& lhs, const EdgeWeight& rhs){
-    return EdgeWeight{lhs.time_ + rhs.time_};
+void RouterHelper::AddEdge(size_t from, size_t to, EdgeWeight time, EdgeInfo info){
+    graph_.AddEdge({from, to, time});
+    edge_infos_.push_back(info);
 }
 
-void RouterHelper::LoadGraph(const transport_directory::TransportCatalogue& db){
-    using Edge = graph::Edge<EdgeWeight>;
+// Every way of loading the graph ends here, so the components always match it.
+void RouterHelper::FreezeGraph(){
+    const auto new_ids = graph_.Freeze();
+    if (!new_ids.empty()){
+        graph::PermuteByIds(edge_infos_, new_ids);
+    }
+    components_ = graph::StrongComponents(graph_);
+}
 
-    static const double meters_per_min = (1000.0 / 60.0) * static_cast<double>(bus_velocity_);
-    size_t index = 0;
+std::pair<size_t, size_t> RouterHelper::AddStopVertices(size_t& index, const transport_directory::Stop* stop){
+    const auto [idx, is_created_idx] = GetOrCreateIndex(index, stop -> name);
+    const auto [wait_idx, is_created_wait] = GetOrCreateWaitVertex(index, stop -> name);
+    vertex_coordinates_[idx] = stop -> coordinates;
+    vertex_coordinates_[wait_idx] = stop -> coordinates;
+    if (is_created_idx || is_created_wait){
+        AddEdge(idx, wait_idx, static_cast<double>(settings_.bus_wait_time), {stop -> name, RoutesType::WAIT});
+    }
+    return {idx, wait_idx};
+}
 
-    for (const auto& bus: db.GetAllBuses()){
-        auto begin = bus.GetStops().begin();
-        auto end = bus.GetStops().end();
-        for (;begin != end; ++begin){
-            const auto [idx, is_created_idx] = GetOrCreateIndex(index, (*begin) -> name);
-            const auto [wait_idx, is_created_wait] = GetOrCreateWaitVertex(index, (*begin) -> name);
-             if (is_created_idx || is_created_wait)
-            {
-                graph_.AddEdge(
-                    Edge{idx, wait_idx, EdgeWeight{(*begin) -> name, static_cast<double>(bus_wait_time_)}.SetAction(
-                            RoutesType::WAIT)
-                    }
-                );
-            }
+void RouterHelper::AddBusEdges(const transport_directory::Bus& bus, const transport_directory::StopList& stops,
+                               const std::vector<double>& segment_times, size_t& index){
+    for (size_t from = 0; from < stops.size(); ++from){
+        const auto [idx, wait_idx] = AddStopVertices(index, stops[from]);
 
-            {
-                double time = 0.0;
-                int span_counter = 0;
-                auto first = begin;
-                auto next = begin;
-                for (++next; next != end; ++first, ++next){
-                    const auto [idx_first, _] = GetOrCreateIndex(index, (*next) -> name);
-                    time += db.GetDistance((*first), (*next)) / meters_per_min;
-                    graph_.AddEdge(Edge{
-                        wait_idx, idx_first, EdgeWeight{bus.name, time}.SetSpan(++span_counter)
-                    });
-                }
-            }
+        double time = 0.0;
+        int span_counter = 0;
+        for (size_t to = from + 1; to < stops.size(); ++to){
+            const auto [idx_to, _] = GetOrCreateIndex(index, stops[to] -> name);
+            time += segment_times[to - 1];
+            AddEdge(wait_idx, idx_to, time, {bus.name, RoutesType::BUS, ++span_counter});
         }
     }
 }
 
+void RouterHelper::AddBusPattern(const transport_directory::Bus& bus, const transport_directory::StopList& stops,
+                                 const std::vector<double>& segment_times, size_t& index, size_t& ride_vertex){
+    for (size_t position = 0; position < stops.size(); ++position){
+        const auto [idx, wait_idx] = AddStopVertices(index, stops[position]);
+        const size_t ride = ride_vertex + position;
+        vertex_coordinates_[ride] = stops[position] -> coordinates;
+
+        if (position > 0){
+            AddEdge(ride, idx, 0.0, {bus.name, RoutesType::ALIGHT});
+        }
+        if (position + 1 < stops.size()){
+            AddEdge(wait_idx, ride, 0.0, {bus.name, RoutesType::BOARD});
+            AddEdge(ride, ride + 1, segment_times[position], {bus.name, RoutesType::RIDE});
+        }
+    }
+    ride_vertex += stops.size();
+}
+
 std::optional<graph::VertexId> RouterHelper::GetVertexId(std::string_view name) const {
-    if (stopname_to_vertex_id.count(name) == 0){
+    const auto it = stopname_to_vertex_id.find(name);
+    if (it == stopname_to_vertex_id.end()){
         return {};
     }
-    return stopname_to_vertex_id.at(name);
+    return it -> second;
 }
 
 std::pair<size_t, bool> RouterHelper::GetOrCreateIndex(size_t& index, std::string_view stopname){
@@ -69,6 +213,142 @@ const graph::Edge<EdgeWeight>& RouterHelper::GetEdge(graph::EdgeId id) const {
     return graph_.GetEdge(id);
 }
 
+const EdgeInfo& RouterHelper::GetEdgeInfo(graph::EdgeId id) const {
+    return edge_infos_[id];
+}
+
+RouteResult RouterHelper::MakeRoute(const graph::BaseRouter<EdgeWeight>::RouteInfo& route) const {
+    return MakeRoute(route.weight, route.edges);
+}
+
+RouteResult RouterHelper::MakeRoute(EdgeWeight total_time, const std::vector<graph::EdgeId>& edges) const {
+    RouteResult result;
+    result.total_time = total_time;
+    result.items.reserve(edges.size());
+    for (const graph::EdgeId edge_id : edges){
+        const EdgeWeight time = graph_.GetEdge(edge_id).weight;
+        const EdgeInfo& info = edge_infos_[edge_id];
+        switch (info.action){
+            case RoutesType::WAIT:
+            case RoutesType::BUS:
+                result.items.push_back({info.action, info.name, time, info.span_count});
+                break;
+            case RoutesType::BOARD:
+                result.items.push_back({RoutesType::BUS, info.name, 0.0, 0});
+                break;
+            case RoutesType::RIDE:
+                result.items.back().time += time;
+                ++result.items.back().span_count;
+                break;
+            case RoutesType::ALIGHT:
+                break;
+        }
+    }
+    return result;
+}
+
+std::vector<graph::VertexId> RouterHelper::SelectLandmarks(size_t count) const {
+    std::vector<graph::VertexId> stops;
+    stops.reserve(stopname_to_vertex_id.size());
+    for (const auto& [name, vertex] : stopname_to_vertex_id){
+        stops.push_back(vertex);
+    }
+    std::sort(stops.begin(), stops.end());
+    count = std::min(count, stops.size());
+
+    std::vector<graph::VertexId> landmarks;
+    landmarks.reserve(count);
+    if (count == 0){
+        return landmarks;
+    }
+
+    // Starting from the stop farthest from the first one puts the first landmark on the
+    // edge of the map rather than wherever the input happened to begin.
+    std::vector<double> nearest_landmark(stops.size(), std::numeric_limits<double>::infinity());
+    graph::VertexId next = stops.front();
+    double farthest = -1.0;
+    for (const graph::VertexId vertex : stops){
+        const double distance = geo::ComputeDistance(vertex_coordinates_[stops.front()], vertex_coordinates_[vertex]);
+        if (distance > farthest){
+            farthest = distance;
+            next = vertex;
+        }
+    }
+
+    while (landmarks.size() < count){
+        landmarks.push_back(next);
+        const geo::Coordinates& landmark = vertex_coordinates_[next];
+        farthest = -1.0;
+        for (size_t i = 0; i < stops.size(); ++i){
+            const double distance = geo::ComputeDistance(landmark, vertex_coordinates_[stops[i]]);
+            nearest_landmark[i] = std::min(nearest_landmark[i], distance);
+            if (nearest_landmark[i] > farthest){
+                farthest = nearest_landmark[i];
+                next = stops[i];
+            }
+        }
+    }
+    return landmarks;
+}
+
+std::unique_ptr<graph::BaseRouter<EdgeWeight>> RouterHelper::BuildRouter() const {
+    switch (settings_.router_type){
+        case RouterType::DIJKSTRA:
+            return std::make_unique<graph::DijkstraRouter<EdgeWeight>>(graph_);
+        case RouterType::CONTRACTION_HIERARCHY:
+            return std::make_unique<graph::ContractionHierarchy<EdgeWeight>>(graph_);
+        case RouterType::ALT:
+            return std::make_unique<graph::AltRouter<EdgeWeight>>(graph_, SelectLandmarks(settings_.landmark_count));
+        case RouterType::HUB_LABELS:
+            return std::make_unique<graph::HubLabels<EdgeWeight>>(graph_);
+        case RouterType::RAPTOR:
+            return nullptr;
+        case RouterType::AUTO:
+            throw std::logic_error("The router is chosen when the graph is loaded");
+        case RouterType::ALL_PAIRS:
+            break;
+    }
+
+    if (precomputed_){
+        return std::make_unique<graph::Router<EdgeWeight>>(
+            graph_, precomputed_ -> GetWeights(), precomputed_ -> GetRouteEdges(), settings_.route_edges);
+    }
+    auto router = std::make_unique<graph::Router<EdgeWeight>>(graph_, settings_.route_edges);
+    if (!settings_.precompute_file.empty()){
+        try {
+            router_storage::PrecomputedRouter::Save(
+                settings_.precompute_file, settings_.input_hash, graph_, edge_infos_, stopname_to_vertex_id, *router);
+        } catch (const std::runtime_error& error) {
+            std::cerr << "precomputed router is not saved: " << error.what() << std::endl;
+        }
+    }
+    return router;
+}
+
+bool RouterHelper::LoadPrecomputedGraph(){
+    // Only all-pairs tables are saved, so a file matching the input of an AUTO run holds
+    // the tables it chose before and will choose again.
+    const bool may_use_tables = settings_.router_type == RouterType::ALL_PAIRS
+        || settings_.router_type == RouterType::AUTO;
+    if (settings_.precompute_file.empty() || !may_use_tables){
+        return false;
+    }
+    auto precomputed = router_storage::PrecomputedRouter::Open(
+        settings_.precompute_file, settings_.input_hash);
+    if (!precomputed || precomputed -> GetVertexCount() != graph_.GetVertexCount()){
+        return false;
+    }
+
+    graph_ = precomputed -> LoadGraph();
+    edge_infos_ = precomputed -> LoadEdgeInfos();
+    FreezeGraph();
+    for (const auto& [name, vertex] : precomputed -> LoadStopVertices()){
+        stopname_to_vertex_id[name] = vertex;
+    }
+    precomputed_ = std::move(precomputed);
+    return true;
+}
+
 std::pair<size_t, bool> RouterHelper::GetOrCreateWaitVertex(size_t& index, std::string_view stopname){
     if (wait_stopname_to_index.count(stopname) == 0){
         wait_stopname_to_index[stopname] = index;
@@ -1,77 +1,140 @@
 #pragma once
 
+#include "alt_router.h"
+#include "contraction_hierarchy.h"
+#include "geo.h"
 #include "graph.h"
+#include "hub_labels.h"
 #include "router.h"
+#include "strong_components.h"
 #include "transport_catalogue.h"
 
+#include <cstdint>
+#include <memory>
 #include <optional>
+#include <string>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
+
+namespace router_storage {
+    class PrecomputedRouter;
+}
+
+enum class RouterType{
+    ALL_PAIRS,
+    DIJKSTRA,
+    CONTRACTION_HIERARCHY,
+    ALT,
+    // Pruned landmark labeling: microsecond queries from labels built once.
+    HUB_LABELS,
+    // Round-based search over the buses' stop sequences, without the routing graph.
+    RAPTOR,
+    // One of the graph routers, chosen by RoutingSettings::memory_budget_mb once the
+    // graph is loaded.
+    AUTO
+};
+
+// How buses become edges. COMPLETE joins each stop to every later stop of a bus with
+// one edge, quadratic in the route length. ROUTE_PATTERN gives each stop of a bus a
+// ride vertex chained to the next one, with boarding and alighting edges to the stop,
+// which is linear in the route length at the cost of more vertices.
+enum class GraphModel{
+    COMPLETE,
+    ROUTE_PATTERN
+};
 
 struct RoutingSettings{
     int bus_wait_time;
     int bus_velocity;
+    RouterType router_type = RouterType::ALL_PAIRS;
+    GraphModel graph_model = GraphModel::COMPLETE;
+    size_t route_cache_size = 4096;
+    // Landmark stops of the ALT router.
+    size_t landmark_count = 8;
+    // What RouterType::AUTO may spend on routing structures beyond the graph.
+    size_t memory_budget_mb = 1024;
+    // Which edges the all-pairs router keeps; first edges rebuild routes without a reverse.
+    graph::RouteEdges route_edges = graph::RouteEdges::LAST;
+    // Where the all-pairs router keeps its tables between runs; empty means nowhere.
+    std::string precompute_file;
+    // Hash of the input the tables depend on, matched against the file.
+    uint64_t input_hash = 0;
 };
 
 enum class RoutesType{
     WAIT,
-    BUS
+    BUS,
+    // Edges of GraphModel::ROUTE_PATTERN, reported together as one BUS item.
+    BOARD,
+    RIDE,
+    ALIGHT
 };
 
-struct EdgeWeight{
-    std::string_view name_ = {};
-    double time_ = {};
-    RoutesType action_ = RoutesType::BUS;
-
-    int span_counter = 0;
-
-    EdgeWeight() = default;
-
-    EdgeWeight(double time)
-        : time_(time){}
+// Routers search on edge times alone; what an edge means for the answer lives in an
+// EdgeInfo table next to the graph, indexed by EdgeId.
+using EdgeWeight = double;
 
-    EdgeWeight(std::string_view name, double time)
-        : name_(name)
-        , time_(time){}
-
-    EdgeWeight& SetAction(RoutesType action){
-        action_ = action;
-        return *this;
-    }
-
-    EdgeWeight& SetSpan(int i){
-        span_counter = i;
-        return *this;
-    }
+struct EdgeInfo{
+    std::string_view name;
+    RoutesType action = RoutesType::BUS;
+    int span_count = 0;
 };
 
-bool operator<(const EdgeWeight& lhs, const EdgeWeight& rhs);
-bool operator>(const EdgeWeight& lhs, const EdgeWeight& rhs);
+// One step of a route as it is reported: waiting at a stop or riding a bus over
+// span_count stops.
+struct RouteItem{
+    RoutesType type = RoutesType::WAIT;
+    std::string_view name;
+    double time = 0.0;
+    int span_count = 0;
+};
 
-EdgeWeight operator+(const EdgeWeight& lhs, const EdgeWeight& rhs);
+struct RouteResult{
+    double total_time = 0.0;
+    std::vector<RouteItem> items;
+};
 
 class RouterHelper{
 private:
-    int bus_wait_time_;
-    int bus_velocity_;
+    RoutingSettings settings_;
     std::unordered_map<std::string_view, size_t> stopname_to_vertex_id;
     std::unordered_map<std::string_view, size_t> wait_stopname_to_index;
     graph::DirectedWeightedGraph<EdgeWeight> graph_;
-
+    std::vector<EdgeInfo> edge_infos_;
+    std::vector<geo::Coordinates> vertex_coordinates_;
+    graph::StrongComponents components_;
+    std::shared_ptr<const router_storage::PrecomputedRouter> precomputed_;
+
+    bool LoadPrecomputedGraph();
+    void SelectRouter();
+    void AddEdge(size_t from, size_t to, EdgeWeight time, EdgeInfo info);
+    void FreezeGraph();
     std::pair<size_t, bool> GetOrCreateIndex(size_t& index, std::string_view stopname);
     std::pair<size_t, bool> GetOrCreateWaitVertex(size_t& index, std::string_view stopname);
+    std::pair<size_t, size_t> AddStopVertices(size_t& index, const transport_directory::Stop* stop);
+    void AddBusEdges(const transport_directory::Bus& bus, const transport_directory::StopList& stops,
+                     const std::vector<double>& segment_times, size_t& index);
+    void AddBusPattern(const transport_directory::Bus& bus, const transport_directory::StopList& stops,
+                       const std::vector<double>& segment_times, size_t& index, size_t& ride_vertex);
 
 public:
     explicit RouterHelper(RoutingSettings settings, size_t graph_size)
-        : bus_wait_time_(settings.bus_wait_time)
-        , bus_velocity_(settings.bus_velocity)
+        : settings_(settings)
         , graph_(graph_size * 2)
+        , vertex_coordinates_(graph_size * 2)
     {
         stopname_to_vertex_id.reserve(graph_size);
         wait_stopname_to_index.reserve(graph_size);
     }
 
+    // Also settles RouterType::AUTO, so GetSettings names the router actually built.
     void LoadGraph(const transport_directory::TransportCatalogue& db);
+
+    const RoutingSettings& GetSettings() const {
+        return settings_;
+    }
+
     const graph::DirectedWeightedGraph<EdgeWeight>& GetGraph() const {
         return graph_;
     }
@@ -80,4 +143,26 @@ public:
 
     const graph::Edge<EdgeWeight>& GetEdge(graph::EdgeId id) const;
 
+    const EdgeInfo& GetEdgeInfo(graph::EdgeId id) const;
+
+    // False when the graph has no route between the vertices, found without a search.
+    bool MayReach(graph::VertexId from, graph::VertexId to) const {
+        return components_.MayReach(from, to);
+    }
+
+    const graph::StrongComponents& GetComponents() const {
+        return components_;
+    }
+
+    // Turns a route found on the graph into the items it is reported with.
+    RouteResult MakeRoute(const graph::BaseRouter<EdgeWeight>::RouteInfo& route) const;
+    RouteResult MakeRoute(EdgeWeight total_time, const std::vector<graph::EdgeId>& edges) const;
+
+    // Stop vertices spread over the map by farthest-point selection: each next landmark
+    // is the stop farthest from all landmarks chosen before it.
+    std::vector<graph::VertexId> SelectLandmarks(size_t count) const;
+
+    // Null for RouterType::RAPTOR, which routes without the graph.
+    std::unique_ptr<graph::BaseRouter<EdgeWeight>> BuildRouter() const;
+
 };